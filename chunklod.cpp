@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "chunklod.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t groundOnly = ~0u;
+// A chunk that keeps changing is rebuilt at most every this many frames.
+static const uint32_t rebuildFrames = 8;
+// Textures kept, the ones out of view longest go first.
+static const size_t maxEntries = 1024;
+
+static void composite(float *dst, uint32_t color)
+{
+	// Same as the GL_ONE, GL_ONE_MINUS_SRC_ALPHA blending the sprites get.
+	uint8_t src[4];
+	memcpy(src, &color, sizeof(src));
+
+	const float inverseAlpha = 1.0f - src[3] / 255.0f;
+	for (int c = 0; c < 4; ++c)
+		dst[c] = src[c] + dst[c] * inverseAlpha;
+}
+
+const TexturePtr& ChunkLodCache::get(const Map& map, const GridPoint& chunkPos, const Chunk *chunk,
+				     const TextureRegistry& textures, Renderer& renderer)
+{
+	// Only the part inside the map is drawn at the edges.
+	const int cols = std::min(map.cols() - chunkPos.x() * CHUNK_SIZE, CHUNK_SIZE);
+	const int rows = std::min(map.rows() - chunkPos.y() * CHUNK_SIZE, CHUNK_SIZE);
+	const uint32_t version = chunk ? chunk->version : groundOnly;
+
+	if (!chunk && cols == CHUNK_SIZE && rows == CHUNK_SIZE) {
+		// Every untouched chunk looks the same.
+		if (!m_ground || m_groundSprite != map.ground()) {
+			uint32_t color = textures.loaded(map.ground()) ? textures[map.ground()]->averageColor() : 0;
+			m_ground = renderer.createTexture();
+			m_ground->upload(reinterpret_cast<const unsigned char *>(&color), 1, 1);
+			m_groundSprite = map.ground();
+		}
+		return m_ground;
+	}
+
+	Entry& entry = m_entries[chunkPos];
+	entry.used = m_frame;
+	if (entry.texture && entry.cols == cols && entry.rows == rows
+	    && (entry.version == version || m_frame - entry.built < rebuildFrames))
+		return entry.texture;
+
+	uint8_t pixels[CHUNK_SIZE * CHUNK_SIZE * 4];
+	memset(pixels, 0, sizeof(pixels));
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < cols; ++x) {
+			const uint32_t cell = GridPoint(x, y).morton();
+			float color[4] = { 0, 0, 0, 0 };
+			for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+				const SpriteId sprite = chunk ? chunk->layers[layer][cell]
+					: (layer == LAYER_GROUND ? map.ground() : SpriteId(SPRITE_NONE));
+				if (sprite != SPRITE_NONE && textures.loaded(sprite))
+					composite(color, textures[sprite]->averageColor());
+			}
+
+			uint8_t *pixel = &pixels[(y * CHUNK_SIZE + x) * 4];
+			for (int c = 0; c < 4; ++c)
+				pixel[c] = std::min(color[c], 255.0f);
+		}
+	}
+
+	if (!entry.texture)
+		entry.texture = renderer.createTexture();
+	entry.texture->upload(pixels, CHUNK_SIZE, CHUNK_SIZE);
+	entry.version = version;
+	entry.cols = cols;
+	entry.rows = rows;
+	entry.built = m_frame;
+	return entry.texture;
+}
+
+void ChunkLodCache::endFrame()
+{
+	if (m_entries.size() > maxEntries) {
+		m_byAge.clear();
+		for (const auto& pair : m_entries)
+			m_byAge.emplace_back(pair.second.used, pair.first);
+
+		// What's in view now stays, however many that is.
+		const size_t excess = m_entries.size() - maxEntries;
+		std::nth_element(m_byAge.begin(), m_byAge.begin() + excess, m_byAge.end(),
+			[] (const std::pair<uint32_t, GridPoint>& a, const std::pair<uint32_t, GridPoint>& b) { return a.first < b.first; });
+		for (size_t i = 0; i < excess; ++i)
+			if (m_byAge[i].first != m_frame)
+				m_entries.erase(m_byAge[i].second);
+	}
+	++m_frame;
+}
+
+void ChunkLodCache::clear()
+{
+	m_entries.clear();
+	m_ground = nullptr;
+	m_groundSprite = SPRITE_NONE;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CHUNKLOD_H
+#define CHUNKLOD_H
+
+#include "map.h"
+#include "textureregistry.h"
+#include "renderer.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Tiles smaller than this many pixels on screen are drawn flat.
+static constexpr float LOD_TILE_PIXELS = 4.0f;
+
+/*
+ * From far away the sprites can't be made out anyway, so each chunk is
+ * drawn as a single quad with one texel per tile: the average colour of
+ * everything on it.  The textures are rebuilt when the chunk changes, no
+ * more often than every few frames, and the ones that haven't been seen
+ * for longest go when there are too many.
+ */
+class ChunkLodCache
+{
+public:
+	ChunkLodCache() : m_frame(0), m_groundSprite(SPRITE_NONE) { }
+
+	const TexturePtr& get(const Map& map, const GridPoint& chunkPos, const Chunk *chunk,
+			      const TextureRegistry& textures, Renderer& renderer);
+	// After every frame that get() was called in.
+	void endFrame();
+	void clear();
+
+private:
+	struct Entry {
+		TexturePtr texture;
+		uint32_t version;
+		int cols, rows;
+		uint32_t built;
+		uint32_t used;
+	};
+
+	uint32_t m_frame;
+	std::unordered_map<GridPoint, Entry> m_entries;
+	// For endFrame(), kept to save allocating.
+	std::vector<std::pair<uint32_t, GridPoint>> m_byAge;
+	TexturePtr m_ground;
+	SpriteId m_groundSprite;
+};
+
+#endif
+
@@ -20,65 +20,175 @@
  * THE SOFTWARE.
  */
 #include "game.h"
-#include "shadersources.h"
+#include "gl2renderer.h"
 
 #include <iostream>
-#include <sstream>
 #include <cmath>
 #include <cstdlib>
-#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <poll.h>
+
+// The AI snakes keep the starting pace.
+static const int aiInterval = 190;
 
 Game::Game() :
 	  m_width(DEFAULT_WIDTH),
 	  m_height(DEFAULT_HEIGHT),
+	  m_worldCols(0),
+	  m_worldRows(0),
 	  m_waitInterval(190),
+	  m_aiSnakes(0),
+	  m_cameraX(0.0f),
+	  m_cameraY(0.0f),
 	  m_zoom(1.0f),
 	  m_newFood(true),
-	  m_removeEvent(nullptr),
-	  m_snake(nullptr),
-	  m_foodTile(nullptr)
+	  m_playerFraction(1.0f),
+	  m_worldFraction(1.0f),
+	  m_world(m_map),
+	  m_food(0),
+	  m_player(NO_SNAKE),
+	  m_remote(false),
+	  m_softRenderer(nullptr)
 {
 }
 
 Game::~Game()
 {
+	m_chunkLods.clear();
+	m_world.clear();
 	m_map.clear();
-	delete m_snake;
 }
 
-TilePtr Game::getRandomTile() const
+// @from + (@to - @from) * @t, the short way round a wrapping world @size
+// wide, so the result can be off either edge by less than a tile.
+static float lerpWrapped(int from, int to, float t, int size)
 {
-	TilePtr ret;
-	TilePtr snakeTile = m_snake->tile();
-	Point offscreenPoint(m_viewportWidth, m_viewportHeight);
+	int distance = to - from;
+	if (distance > size / 2)
+		distance -= size;
+	else if (distance < -size / 2)
+		distance += size;
+	return from + distance * t;
+}
 
-	do
-		ret = m_map.getRandomTile();
-	while (ret && ret->pos() != snakeTile->pos() && ret->pos() != offscreenPoint);
+// Calls @f(x, y) for where a tile at (@x, @y) shows up, the far edge too
+// while it slides over the edge of the world.
+template<typename F>
+static void forEachWrapped(float x, float y, float worldW, float worldH, F f)
+{
+	const float xs[] = { x, x < 0 ? x + worldW : x - worldW };
+	const float ys[] = { y, y < 0 ? y + worldH : y - worldH };
+	const int nx = x < 0 || x > worldW - TILE_SIZE ? 2 : 1;
+	const int ny = y < 0 || y > worldH - TILE_SIZE ? 2 : 1;
+	for (int i = 0; i < ny; ++i)
+		for (int j = 0; j < nx; ++j)
+			f(xs[j], ys[i]);
+}
+
+Point Game::getRandomPos() const
+{
+	Point ret;
+	Point offscreenPoint(m_maxX, m_maxY);
+
+	do {
+		if (!m_map.getRandomPos(visibleArea(), ret))
+			return offscreenPoint;
+	} while (m_world.occupant(GridPoint::fromPixels(ret)) != NO_SNAKE || ret == offscreenPoint);
 	return ret;
 }
 
 void Game::createMapTiles()
 {
-	TilePtr newTile;
-
-	int x, y;
-	for (x = 0, y = 0 ;; x += 32) {
-		if (x >= m_width) {
-			m_viewportWidth = x - 32;
-			x = 0;
-			y += 32;
-		}
-		// Make sure we don't render offscreen
-		if (y >= m_height)
-			break;
+	// Unless told otherwise the world is just what fits in the window.
+	const int cols = m_worldCols ? m_worldCols : (m_width + 31) / 32;
+	const int rows = m_worldRows ? m_worldRows : (m_height + 31) / 32;
+
+	m_map.resize(cols, rows, SPRITE_GRASS);
+
+	m_maxX = (cols - 1) * 32;
+	m_maxY = (rows - 1) * 32;
+}
+
+GridRect Game::visibleArea() const
+{
+	const float halfW = m_width / 2.0f / m_zoom;
+	const float halfH = m_height / 2.0f / m_zoom;
 
-		newTile = TilePtr(new Tile(Point(x, y)));
-		newTile->addTexture(m_grassTexture);
-		m_map.addTile(newTile);
+	const int x0 = std::floor((m_cameraX - halfW) / 32.f);
+	const int y0 = std::floor((m_cameraY - halfH) / 32.f);
+	const int x1 = std::ceil((m_cameraX + halfW) / 32.f);
+	const int y1 = std::ceil((m_cameraY + halfH) / 32.f);
+
+	GridRect area = { x0, y0, x1 - x0, y1 - y0 };
+	return area;
+}
+
+void Game::updateCamera()
+{
+	// Follow the snake but don't look past the edges of the world,
+	// if it all fits then just keep it centered.
+	const float worldW = m_map.cols() * 32.f;
+	const float worldH = m_map.rows() * 32.f;
+	const float halfW = m_width / 2.0f / m_zoom;
+	const float halfH = m_height / 2.0f / m_zoom;
+
+	float x = m_remoteHead.x();
+	float y = m_remoteHead.y();
+	if (!m_remote)
+		snakePixels(m_player, x, y);
+	x += 16.f;
+	y += 16.f;
+	x = halfW * 2 >= worldW ? worldW / 2 : std::min(std::max(x, halfW), worldW - halfW);
+	y = halfH * 2 >= worldH ? worldH / 2 : std::min(std::max(y, halfH), worldH - halfH);
+
+	if (x != m_cameraX || y != m_cameraY) {
+		m_cameraX = x;
+		m_cameraY = y;
+		updateView();
 	}
+}
 
-	m_viewportHeight = y - 32;
+void Game::updateTickFractions()
+{
+	const Clock::Time now = g_sched.now();
+	const float playerMs = std::chrono::duration<float, std::milli>(now - m_playerTick).count();
+	const float worldMs = std::chrono::duration<float, std::milli>(now - m_worldTick).count();
+	m_playerFraction = std::min(std::max(playerMs / m_waitInterval, 0.0f), 1.0f);
+	m_worldFraction = std::min(std::max(worldMs / aiInterval, 0.0f), 1.0f);
+}
+
+void Game::snakePixels(SnakeId id, float& x, float& y) const
+{
+	// Whole pixels, linear filtering would blur the sprite otherwise.
+	const Snake& snake = m_world.snake(id);
+	const float t = id == m_player ? m_playerFraction : m_worldFraction;
+	x = std::floor(lerpWrapped(snake.lastPos().x(), snake.pos().x(), t, m_map.cols() * TILE_SIZE) + 0.5f);
+	y = std::floor(lerpWrapped(snake.lastPos().y(), snake.pos().y(), t, m_map.rows() * TILE_SIZE) + 0.5f);
+}
+
+// Calls @f(SpriteId sprite, float x, float y) for every snake around
+// @area, where it is drawn this frame.
+template<typename F>
+void Game::forEachSnake(const GridRect& area, F f) const
+{
+	// A tile more all round for those sliding in from outside.
+	const GridRect around = { area.x - 1, area.y - 1, area.cols + 2, area.rows + 2 };
+	const float worldW = m_map.cols() * TILE_SIZE;
+	const float worldH = m_map.rows() * TILE_SIZE;
+	m_map.forEachSprite(LAYER_ACTOR, around,
+		[this, worldW, worldH, &f] (const GridPoint& pos, SpriteId sprite) {
+			const SnakeId id = m_world.occupant(pos);
+			if (id == NO_SNAKE) {
+				const Point pixels = pos.toPixels();
+				f(sprite, pixels.x(), pixels.y());
+				return;
+			}
+
+			float x, y;
+			snakePixels(id, x, y);
+			forEachWrapped(x, y, worldW, worldH, [sprite, &f] (float x, float y) { f(sprite, x, y); });
+		});
 }
 
 void Game::makeFood()
@@ -86,300 +196,384 @@ void Game::makeFood()
 	if (!m_newFood)
 		return;
 
-	const auto& textures = !(rand() % 5) ? m_baitTextures : m_appleTextures;
-	int randomIndex = rand() % 8;
-	const TexturePtr& foodTex = textures[randomIndex];
-	if (!foodTex) {
-		std::cerr << "Internal error: No apple texture at index " << randomIndex << ", aborting..." << std::endl;
-		std::abort();
-	}
+	const SpriteId first = !(rand() % 5) ? SPRITE_STRAWBERRY_FIRST : SPRITE_APPLE_FIRST;
+	const SpriteId foodSprite = first + rand() % 8;
+	if (m_softRenderer ? !m_softRenderer->loaded(foodSprite) : !m_textures.loaded(foodSprite))
+		return;		// Still decoding, try again next frame.
 
 	/* Figure out place position.  */
-	const TilePtr& placeTile = getRandomTile();
-	if (!placeTile) {
-		/* Impossible to reach here...  */
-		std::cerr << "Internal error: Could find a suitable tile to place the food over, aborting..." << std::endl;
-		std::abort();
-	}
-
-	m_foodTile = placeTile;
-	m_foodTile->addTexture(foodTex);
+	m_foodPos = getRandomPos();
+	m_map.setSprite(m_foodPos, LAYER_ITEM, foodSprite);
 	m_newFood = false;
 
-	// Remove old one and schedule new if there is (most likely there is)
-	if (m_removeEvent && !m_removeEvent->expired())
-		g_sched.removeEvent(m_removeEvent);
-	m_removeEvent = g_sched.scheduleEvent(std::bind(&Game::removeFood, &g_game), m_waitInterval + 2000);
+	expireFood(++m_food);
 }
 
-bool Game::initialize()
+bool Game::connect(const std::string& host, int port)
 {
-	m_program.create();
-	if (!m_program.compile(GL_VERTEX_SHADER, vertexSource))
-		return false;
-
-	if (!m_program.compile(GL_FRAGMENT_SHADER, fragmentSource))
+	if (!m_connection.connect(host, port))
 		return false;
 
-	m_program.bindAttribLocation(Position, "vertex");
-	m_program.bindAttribLocation(TexCoord, "texcoord");
-	if (!m_program.link()) {
-		std::cerr << "Failed to link the GL shader program: " << m_program.log() << std::endl;
-		return false;
+	// Everything but the welcome is handled by receiveState() later.
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	const uint8_t *data;
+	size_t size;
+	while (!m_connection.nextMessage(data, size)) {
+		pollfd fd = { m_connection.fd(), POLLIN, 0 };
+		if (std::chrono::steady_clock::now() > deadline || ::poll(&fd, 1, 100) < 0
+		    || ((fd.revents & POLLIN) && !m_connection.receive()) || m_connection.broken()) {
+			std::cerr << "No welcome from " << host << ":" << port << std::endl;
+			m_connection.close();
+			return false;
+		}
 	}
-	m_program.bind();
 
-	m_grassTexture = TexturePtr(new Texture);
-	if (!m_grassTexture->loadTexture("textures/grass.png")) {
-		std::cerr << "Failed to load the grass texture." << std::endl;
+	MessageReader in(data, size);
+	const uint8_t type = in.u8();
+	const uint16_t version = in.u16();
+	const int cols = in.u16();
+	const int rows = in.u16();
+	in.u16();	// Ground, always grass for now.
+	const SnakeId snake = in.u32();
+	if (!in.ok() || type != MSG_WELCOME || version != PROTOCOL_VERSION || !cols || !rows) {
+		std::cerr << "Unexpected welcome from " << host << ":" << port
+			<< ", protocol version " << version << " while " << PROTOCOL_VERSION << " is needed" << std::endl;
+		m_connection.close();
 		return false;
 	}
 
-	for (int i = 0; directions[i]; ++i) {
-		std::stringstream ss;
-		ss << "textures/snake_" << directions[i] << ".png";
+	setWorldSize(cols, rows);
+	m_player = snake;
+	m_remote = true;
+	return true;
+}
 
-		TexturePtr newTexture(new Texture);
-		if (!newTexture->loadTexture(ss.str())) {
-			std::cerr << "Failed to load Snake Texture from: " << ss.str() << std::endl;
+void Game::receiveState()
+{
+	// What came in with the EOF still counts.
+	const bool open = m_connection.receive();
+
+	const uint8_t *data;
+	size_t size;
+	while (m_connection.nextMessage(data, size)) {
+		MessageReader in(data, size);
+		const uint8_t type = in.u8();
+		if (type != MSG_SNAPSHOT && type != MSG_TICK)
 			continue;
+
+		uint32_t tick;
+		if (!readState(in, tick, m_heads, m_cells)) {
+			std::cerr << "Malformed state from the server." << std::endl;
+			m_connection.close();
+			return;
 		}
 
-		m_snakeTextures[i] = newTexture;
+		for (const CellChange& cell : m_cells)
+			if (m_map.contains(cell.pos) && cell.sprite < SPRITE_COUNT)
+				m_map.setSprite(cell.pos, static_cast<TileLayer>(cell.layer), cell.sprite);
+		// Spectators follow whoever plays first.
+		for (const SnakeHead& head : m_heads)
+			if (head.id == m_player || (m_player == NO_SNAKE && &head == &m_heads.front()))
+				m_remoteHead = head.pos.toPixels();
 	}
-	m_snake = new Snake;
-
-	for (int i = 1; i < 9; i++) {
-		std::stringstream ss;
-		ss << "textures/food/apple" << i << ".png";
 
-		TexturePtr newTexture(new Texture);
-		if (!newTexture->loadTexture(ss.str())) {
-			std::cerr << "Failed to load Apple Texture from: " << ss.str() << std::endl;
-			continue;
-		}
-		m_appleTextures[i - 1] = newTexture;
+	if (m_connection.broken()) {
+		std::cerr << "Malformed message from the server." << std::endl;
+		m_connection.close();
+	} else if (!open) {
+		std::cerr << "Lost the connection to the server." << std::endl;
+		m_connection.close();
 	}
+}
 
-	for (int i = 1; i < 9; ++i) {
-		std::stringstream ss;
-		ss << "textures/food/strawberry" << i << ".png";
+bool Game::initialize()
+{
+	if (m_softRenderer)
+		return m_softRenderer->loadSprites();
 
-		TexturePtr newTexture(new Texture);
-		if (!newTexture->loadTexture(ss.str())) {
-			std::cerr << "Failed to load Strawberry texture from: " << ss.str() << std::endl;
+	if (!m_renderer)
+		m_renderer.reset(new GL2Renderer);
+	if (!m_renderer->initialize())
+		return false;
+	updateView();
+
+	m_textureCache.open(TEXTURE_CACHE);
+	m_textureLoader.setCache(&m_textureCache);
+	m_textureLoader.start();
+
+	// The food is not needed for the first frame, makeFood() only picks
+	// textures that have finished loading.
+	// Sprites without a file of their own share their image's texture.
+	for (SpriteId sprite = SPRITE_GRASS; sprite < SPRITE_COUNT; ++sprite) {
+		if (!spriteFiles[sprite]) {
+			m_textures.set(sprite, m_textures[spriteImage(sprite)]);
 			continue;
 		}
-		m_baitTextures[i - 1] = newTexture;
+		TexturePtr newTexture = m_renderer->createSpriteTexture(sprite);
+		m_textures.set(sprite, newTexture);
+		m_textureLoader.queue(newTexture, spriteFiles[sprite]);
+	}
+	m_textureLoader.close();
+
+	if (!m_textureLoader.wait(m_textures[SPRITE_GRASS])) {
+		std::cerr << "Failed to load the grass texture." << std::endl;
+		return false;
 	}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	m_textureLoader.wait(m_textures[SPRITE_SNAKE_FIRST]);
 	return true;
 }
 
 void Game::render()
 {
-	glClear(GL_COLOR_BUFFER_BIT);
+	if (m_textureLoader.pending())
+		m_textureLoader.poll();
+	// First run or some texture changed, save them for next time.  They
+	// may all have come in during initialize() already.
+	if (!m_textureLoader.pending())
+		m_textureCache.flush();
+
+	if (m_remote) {
+		if (m_connection.isOpen())
+			receiveState();
+	} else if (!m_newFood && m_map.sprite(m_foodPos, LAYER_ITEM) == SPRITE_NONE)
+		m_newFood = true;	// Somebody else ate it.
+
+	if (m_softRenderer) {
+		renderSoft(*m_softRenderer);
+		if (m_newFood && !m_remote)
+			makeFood();
+		return;
+	}
+
+	updateTickFractions();
+	updateCamera();
+	m_renderer->beginFrame();
+
+	// Only what the camera sees is submitted, no matter how big the world is.
+	const GridRect area = visibleArea();
+
+	if (32.f * m_zoom < LOD_TILE_PIXELS) {
+		// Too far to make anything out, one flat coloured quad per chunk.
+		m_map.forEachChunk(area,
+			[this] (const GridPoint& chunkPos, const Chunk *chunk) {
+				const Point pixels = GridPoint(chunkPos.x() * CHUNK_SIZE, chunkPos.y() * CHUNK_SIZE).toPixels();
+				m_renderer->submit(LAYER_GROUND, m_chunkLods.get(m_map, chunkPos, chunk, m_textures, *m_renderer),
+						   pixels.x(), pixels.y(), CHUNK_SIZE * 32);
+			});
+		m_chunkLods.endFrame();
+	} else {
+		for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+			// The snakes slide between cells at the display rate.
+			if (layer == LAYER_ACTOR && !m_remote) {
+				forEachSnake(area,
+					[this, layer] (SpriteId sprite, float x, float y) {
+						m_renderer->submitSprite(layer, sprite, m_textures[sprite], x, y);
+					});
+				continue;
+			}
 
-	for (const TilePtr& tile : m_map.getTiles())
-		for (const TexturePtr& texture : tile->getTextures())
-			renderAt(tile->pos(), texture);
-	if (m_newFood)
+			m_map.forEachSprite(static_cast<TileLayer>(layer), area,
+				[this, layer] (const GridPoint& pos, SpriteId sprite) {
+					m_renderer->submitTile(layer, sprite, m_textures[sprite], pos);
+				});
+		}
+	}
+	m_renderer->endFrame();
+	if (m_newFood && !m_remote)
 		makeFood();
 }
 
+void Game::renderSoft(SoftRenderer& renderer)
+{
+	updateTickFractions();
+	updateCamera();
+	renderer.setView(m_cameraX, m_cameraY, m_zoom);
+	const GridRect area = visibleArea();
+
+	// Far out only the ground goes per chunk, the CPU pays per pixel anyway.
+	const bool far = 32.f * m_zoom < LOD_TILE_PIXELS;
+	if (far) {
+		m_map.forEachChunk(area,
+			[this, &renderer] (const GridPoint& chunkPos, const Chunk *) {
+				const Point pixels = GridPoint(chunkPos.x() * CHUNK_SIZE, chunkPos.y() * CHUNK_SIZE).toPixels();
+				renderer.submit(LAYER_GROUND, m_map.ground(), pixels.x(), pixels.y(), CHUNK_SIZE * 32);
+			});
+	}
+
+	for (int layer = far ? LAYER_ITEM : LAYER_GROUND; layer < LAYER_COUNT; ++layer) {
+		if (layer == LAYER_ACTOR && !m_remote) {
+			forEachSnake(area,
+				[&renderer, layer] (SpriteId sprite, float x, float y) {
+					renderer.submit(layer, sprite, x, y);
+				});
+			continue;
+		}
+
+		m_map.forEachSprite(static_cast<TileLayer>(layer), area,
+			[&renderer, layer] (const GridPoint& pos, SpriteId sprite) {
+				const Point pixels = pos.toPixels();
+				renderer.submit(layer, sprite, pixels.x(), pixels.y());
+			});
+	}
+	renderer.flush();
+}
+
 void Game::resize(int w, int h)
 {
 	m_width  = w;
 	m_height = h;
 
-	glViewport(0, 0, w, h);
-	updateProjectionMatrix();
+	if (m_softRenderer)
+		m_softRenderer->resize(w, h);
+	else if (m_renderer)
+		m_renderer->resize(w, h);
+	updateView();
 
-	m_map.clear();
 	createMapTiles();
 
 	static bool firstTime = true;
-	if (firstTime) {
-		m_snake->setTile(m_map.getTile(Point(32, 32)));
-		m_snake->setTexture(m_snakeTextures[0]);
-		m_snake->setDirection(DIRECTION_EAST);
-		g_sched.scheduleEvent(std::bind(&Game::updateSnakePos, &g_game), m_waitInterval);
+	if (firstTime && !m_remote) {
+		m_player = m_world.addSnake(Point(32, 32), DIRECTION_EAST, CONTROL_LOCAL);
+		movePlayer();
+
+		if (m_aiSnakes) {
+			const int spawned = m_world.spawn(m_aiSnakes);
+			if (spawned < m_aiSnakes)
+				std::cerr << "Only room for " << spawned << " AI snakes." << std::endl;
+			moveAiSnakes();
+		}
 		firstTime = false;
 	}
 
-	if (m_foodTile) {
-		Point foodPos = m_foodTile->pos();
-		// If we are resized from a high size into
-		// a low one, then we need to reposition the
-		// apple to fit the scene viewport.
-		// However, instead of doing such job,
-		// we will just create new food elsewhere.
-		if (foodPos.x() >= w || foodPos.y() >= h) {
-			const TilePtr& placeTile = getRandomTile();
-			if (!placeTile) {
-				/* Impossible to reach here...  */
-				std::cerr << "Internal error: Could find a suitable tile to place the food over, aborting..." << std::endl;
-				std::abort();
-			}
+	if (m_worldCols && m_worldRows)
+		return;		// Only the view changed.
 
-			const TexturePtr& foodTexture = m_foodTile->getTextures()[1];
-			m_foodTile = placeTile;
-			m_foodTile->addTexture(foodTexture);
-		} else {
-			// Remove the tile at the last food position
-			m_map.removeTile(foodPos);
-			// Now render the apple at it's previous position.
-			m_map.addTile(m_foodTile);
+	// Cells that fell outside are kept by the map for when the window
+	// grows back, so take the snake and the food off them.
+	if (!m_map.contains(player().pos())) {
+		m_world.moveSnake(m_player, Point(std::min(player().pos().x(), m_maxX),
+						  std::min(player().pos().y(), m_maxY)));
+		player().beginTick();
+	}
+
+	if (!m_map.contains(m_foodPos)) {
+		const SpriteId foodSprite = m_map.sprite(m_foodPos, LAYER_ITEM);
+		if (foodSprite != SPRITE_NONE) {
+			m_map.setSprite(m_foodPos, LAYER_ITEM, SPRITE_NONE);
+			m_foodPos = getRandomPos();
+			m_map.setSprite(m_foodPos, LAYER_ITEM, foodSprite);
 		}
 	}
 }
 
-void Game::updateProjectionMatrix()
+void Game::updateView()
 {
-	float w = m_width;
-	float h = m_height;
-	//  Coordinate      Projection Matrix			        GL Coordinate (Transformed)
-	//                  | 2.0 / width |   0.0           | 0.0  |
-	//  | x  y  1 |  *  | 0.0         |  -2.0 / height  | 0.0  | =  | x' y' 1 |
-	//                  |-1.0         |   1.0           | 1.0  |
-	GLfloat projectionMatrix[] = {
-		 2.0f/w*m_zoom,	  0.0f,		 0.0f,
-		 0.0f,		  2.0f/h*m_zoom, 0.0f,
-		-1.0f,		 -1.0f,		 1.0f
-	};
-
-	m_program.setProjectionMatrix(projectionMatrix);
+	if (m_renderer)
+		m_renderer->setView(m_cameraX, m_cameraY, m_zoom);
 }
 
 void Game::setSnakeDirection(Direction_t dir)
 {
-	if (m_snake->dead())
+	if (snakeSprite(dir) == SPRITE_NONE) {
+		std::cerr << "Invalid direction!" << std::endl;
 		return;
+	}
 
-	m_snake->setDirection(dir);
-	TexturePtr newTexture;
-	// Have a look at Game::initialize() for the trivial indices.
-	switch (dir) {
-	case DIRECTION_NORTH:
-		newTexture = m_snakeTextures[3];
-		break;
-	case DIRECTION_SOUTH:
-		newTexture = m_snakeTextures[2];
-		break;
-	case DIRECTION_EAST:
-	case DIRECTION_NORTHEAST:
-	case DIRECTION_SOUTHEAST:
-		newTexture = m_snakeTextures[0];
-		break;
-	case DIRECTION_WEST:
-	case DIRECTION_NORTHWEST:
-	case DIRECTION_SOUTHWEST:
-		newTexture = m_snakeTextures[1];
-		break;
-	case DIRECTION_INVALID:
-	default:
-		std::cerr << "Invalid direction!" << std::endl;
+	if (m_remote) {
+		if (m_player == NO_SNAKE)
+			return;		// Only watching.
+
+		std::vector<uint8_t> message;
+		writeInput(message, dir);
+		if (!m_connection.send(message))
+			m_connection.close();
 		return;
 	}
-	m_snake->setTexture(newTexture);
+
+	if (player().dead())
+		return;
+	m_world.steer(m_player, dir);
 }
 
-void Game::updateSnakePos()
+bool Game::updateSnakePos()
 {
-	if (m_snake->dead())
-		return;
+	if (player().dead())
+		return false;
 
 	// Snake Position Controller
-	Point movePos = m_snake->move();
-	if (m_foodTile) {
-		eatApple(movePos);	// First try, don't know if offscreen yet...
-		movePos.checkBounds(m_viewportWidth, m_viewportHeight);
-		eatApple(movePos);	// Second try, if offscreen eat apple and switch position.
-	}
+	player().beginTick();
+	m_playerTick = g_sched.now();
+	Point movePos = player().move();
+	movePos.checkBounds(m_maxX, m_maxY);
 
-	TilePtr moveTile = m_map.getTile(movePos);
-	if (!moveTile) {
+	if (!m_map.contains(movePos)) {
 		std::cerr << "Internal error: Failed to find a tile to move the snake on."
 			<< " Move pos: " << movePos << std::endl;
-		return;
+		return false;
 	}
 
-	moveTile->addTexture(m_snake->tile()->popTexture());
-	m_snake->setTile(moveTile);
+	// Bumped into another snake, wait for it to get out of the way.
+	if (m_world.moveSnake(m_player, movePos))
+		eatApple(movePos);
+	return true;
+}
+
+void Game::updateWorld()
+{
+	m_world.step();
+	m_worldTick = g_sched.now();
+}
+
+Script Game::movePlayer()
+{
+	// The interval is looked at anew every time, eating changes it.
+	do
+		co_await g_sched.sleep(m_waitInterval);
+	while (updateSnakePos());
+}
+
+Script Game::moveAiSnakes()
+{
+	for (;;) {
+		co_await g_sched.sleep(aiInterval);
+		updateWorld();
+	}
+}
 
-	g_sched.scheduleEvent(std::bind(&Game::updateSnakePos, &g_game), m_waitInterval);
+Script Game::expireFood(uint32_t food)
+{
+	co_await g_sched.sleep(m_waitInterval + 2000);
+	if (food == m_food)
+		removeFood();
 }
 
 void Game::removeFood()
 {
-	assert(m_foodTile);
-	const auto& textures = m_foodTile->getTextures();
-	if (textures.size() > 1) {
-		m_foodTile->removeTexture(textures[1]);
+	if (m_map.sprite(m_foodPos, LAYER_ITEM) != SPRITE_NONE) {
+		m_map.setSprite(m_foodPos, LAYER_ITEM, SPRITE_NONE);
 		m_newFood = true;
 	}
 }
 
 void Game::eatApple(const Point& foodPos)
 {
-	const auto& textures = m_foodTile->getTextures();
-
-	if (textures.size() > 1 && foodPos == m_foodTile->pos()) {
-		int damage = 0;
-		const TexturePtr& foodTexture = textures[1];
-		if (foodTexture) {
-			for (int i = 1; i < 9; ++i) {
-				if (foodTexture == m_appleTextures[i - 1]) {
-					damage = i;
-					break;
-				} else if (foodTexture == m_baitTextures[i - 1]) {
-					damage = -i;
-					break;
-				}
-			}
-		}
+	if (foodPos != m_foodPos) {
+		// Food put out for the AI snakes, it doesn't speed the game up.
+		m_world.eat(m_player, GridPoint::fromPixels(foodPos));
+		return;
+	}
+
+	const SpriteId foodSprite = m_map.sprite(m_foodPos, LAYER_ITEM);
 
-		int hp = m_snake->eat(damage);
+	if (foodSprite != SPRITE_NONE) {
+		int hp = player().eat(World::foodValue(foodSprite));
 		if (hp) {
 			m_newFood = true;
 			if (m_waitInterval - (hp / 3) >= 100)
 				m_waitInterval -= hp / 3;
 		}
 
-		m_foodTile->removeTexture(foodTexture);
+		m_map.setSprite(m_foodPos, LAYER_ITEM, SPRITE_NONE);
 	}
 }
-
-void Game::renderAt(const Point& pos, const TexturePtr& texture)
-{
-	static const GLubyte indices[] = {
-		0, 1, 2,
-		0, 2, 3
-	};
-	static const GLfloat texcoord[] = {
-		0, 0,
-		1, 0,
-		1, 1,
-		0, 1
-	};
-
-	float x = std::floor(pos.x() / 32.f) * 32.f;
-	float y = std::floor(pos.y() / 32.f) * 32.f;
-
-	const GLfloat vertices[] = {
-		x,	y,
-		x + 32, y,
-		x + 32, y + 32,
-		x,	y + 32
-	};
-
-	m_program.setVertexData(Position, vertices, 2);
-	m_program.setVertexData(TexCoord, texcoord, 2);
-
-	texture->bind();
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices);
-}
-
@@ -23,70 +23,124 @@
 #define GAME_H
 
 #include "map.h"
-#include "snake.h"
-#include "shaderprogram.h"
+#include "world.h"
+#include "renderer.h"
 #include "scheduler.h"
+#include "script.h"
+#include "textureloader.h"
+#include "textureregistry.h"
+#include "chunklod.h"
+#include "softrenderer.h"
+#include "protocol.h"
+#include "net.h"
 
-static const char *directions[] = {
-	"right",	// 0 - lookin right
-	"left",		// 1 - lookin left
-	"up",		// 2 - lookin up
-	"down",		// 3 - lookin down
-	NULL
-};
-
-#define Position 0
-#define TexCoord 1
+#include <string>
+#include <memory>
 
 #define DEFAULT_WIDTH 400
 #define DEFAULT_HEIGHT 400
 
+#define TEXTURE_CACHE "textures.cache"
+
 class Game
 {
 public:
 	Game();
 	~Game();
 
+	// Play on a server instead, before initialize().
+	bool connect(const std::string& host, int port);
+	// Takes ownership, before initialize().  GL2 unless told otherwise.
+	void setRenderer(Renderer *renderer) { m_renderer.reset(renderer); }
+	Renderer *renderer() const { return m_renderer.get(); }
+	// Draw with the CPU instead, before initialize().
+	void setSoftRenderer(SoftRenderer *renderer) { m_softRenderer = renderer; }
 	bool initialize();
 	void render();
+	// Draws what render() would, only with @renderer.
+	void renderSoft(SoftRenderer& renderer);
 	void resize(int w, int h);
 	float getZoom() const { return m_zoom; }
-	void setZoom(float newZoom) { m_zoom = newZoom; updateProjectionMatrix(); }
+	void setZoom(float newZoom) { m_zoom = newZoom; updateView(); }
+	// In tiles, 0 makes the world follow the window size.
+	void setWorldSize(int cols, int rows) { m_worldCols = cols; m_worldRows = rows; }
+	// AI snakes sharing the world with the player.
+	void setAiSnakes(int count) { m_aiSnakes = count; }
 
 	void setSnakeDirection(Direction_t dir);
-	void updateSnakePos();
+	// False once the player can't move any more.
+	bool updateSnakePos();
 	void removeFood();
+	void updateWorld();
+
+	bool loading() const { return m_textureLoader.pending() != 0; }
 
 protected:
 	void createMapTiles();
 	void makeFood();
 	void eatApple(const Point& foodPos);
-	void renderAt(const Point& pos, const TexturePtr& texture);
-	void updateProjectionMatrix();
 
-	TilePtr getRandomTile() const;
+	Script movePlayer();
+	Script moveAiSnakes();
+	Script expireFood(uint32_t food);
+	void updateView();
+	void updateCamera();
+	void updateTickFractions();
+	void snakePixels(SnakeId id, float& x, float& y) const;
+	template<typename F>
+	void forEachSnake(const GridRect& area, F f) const;
+	GridRect visibleArea() const;
+	void receiveState();
+
+	Point getRandomPos() const;
+	Snake& player() { return m_world.snake(m_player); }
+	const Snake& player() const { return m_world.snake(m_player); }
 
 private:
 	int m_width;
 	int m_height;
-	int m_viewportWidth;
-	int m_viewportHeight;
+	int m_worldCols;
+	int m_worldRows;
+	// Largest tile position in pixels, the snake wraps around past it.
+	int m_maxX;
+	int m_maxY;
 	int m_waitInterval;
+	int m_aiSnakes;
+	// Center of the view in world pixels.
+	float m_cameraX;
+	float m_cameraY;
 	float m_zoom;
 	bool m_newFood;
 
-	Map m_map;
-	ShaderProgram m_program;
-
-	TexturePtr m_grassTexture;
+	// When the player and the AI snakes last moved, and how far into
+	// their next move this frame is.
+	Clock::Time m_playerTick;
+	Clock::Time m_worldTick;
+	float m_playerFraction;
+	float m_worldFraction;
 
-	std::array<TexturePtr, sizeof(directions) / sizeof(directions[0])> m_snakeTextures;
-	std::array<TexturePtr, 8> m_appleTextures;
-	std::array<TexturePtr, 8> m_baitTextures;
-
-	EventPtr m_removeEvent;
-	Snake *m_snake;
-	TilePtr m_foodTile;
+	Map m_map;
+	World m_world;
+	std::unique_ptr<Renderer> m_renderer;
+	TextureCache m_textureCache;
+	TextureLoader m_textureLoader;
+
+	TextureRegistry m_textures;
+	ChunkLodCache m_chunkLods;
+
+	// Counts the food put down, for expireFood() to tell if it's the same.
+	uint32_t m_food;
+	SnakeId m_player;
+	Point m_foodPos;
+
+	// Set when the server runs the game and the map is just what it sent.
+	bool m_remote;
+	Connection m_connection;
+	Point m_remoteHead;
+	std::vector<SnakeHead> m_heads;
+	std::vector<CellChange> m_cells;
+
+	SoftRenderer *m_softRenderer;
 };
 
 extern Game g_game;
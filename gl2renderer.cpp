@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "gl2renderer.h"
+#include "shadersources.h"
+#include "glstate.h"
+
+#include <iostream>
+
+enum {
+	Position,
+	TexCoord,
+	Orientation
+};
+
+GL2Renderer::GL2Renderer()
+	: m_renderQueue(Position, TexCoord, Orientation),
+	  m_quads(0)
+{
+}
+
+bool GL2Renderer::initialize()
+{
+	m_program.create();
+	if (!m_program.compile(GL_VERTEX_SHADER, vertexSource))
+		return false;
+
+	if (!m_program.compile(GL_FRAGMENT_SHADER, fragmentSource))
+		return false;
+
+	m_program.bindAttribLocation(Position, "vertex");
+	m_program.bindAttribLocation(TexCoord, "texcoord");
+	m_program.bindAttribLocation(Orientation, "orientation");
+	if (!m_program.link()) {
+		std::cerr << "Failed to link the GL shader program: " << m_program.log() << std::endl;
+		return false;
+	}
+	m_program.bind();
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	return true;
+}
+
+void GL2Renderer::beginFrame()
+{
+	if (m_viewChanged) {
+		GLfloat matrix[9];
+		projectionMatrix(matrix);
+		glViewport(0, 0, m_width, m_height);
+		m_program.setProjectionMatrix(matrix);
+		m_viewChanged = false;
+	}
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	m_quads = 0;
+}
+
+void GL2Renderer::submit(unsigned layer, const TexturePtr& texture, float x, float y,
+			 float size, uint8_t orientation)
+{
+	m_renderQueue.submit(layer, &m_program, texture, x, y, size, orientation);
+	++m_quads;
+}
+
+void GL2Renderer::endFrame()
+{
+	m_renderQueue.flush();
+	m_lastFrame.quads = m_quads;
+	m_lastFrame.drawCalls = m_renderQueue.lastDrawCalls();
+	g_glState.endFrame();
+}
+
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef GL2RENDERER_H
+#define GL2RENDERER_H
+
+#include "renderer.h"
+#include "shaderprogram.h"
+#include "renderqueue.h"
+
+/* GLSL 1.10 and client side vertex arrays, runs about anywhere.  */
+class GL2Renderer : public Renderer
+{
+public:
+	GL2Renderer();
+
+	const char *name() const { return "gl2"; }
+	int glVersion() const { return 20; }
+	bool initialize();
+	TexturePtr createTexture() { return TexturePtr(new Texture); }
+
+	void beginFrame();
+	void submit(unsigned layer, const TexturePtr& texture, float x, float y,
+		    float size = 32, uint8_t orientation = 0);
+	void endFrame();
+
+private:
+	ShaderProgram m_program;
+	RenderQueue m_renderQueue;
+	size_t m_quads;
+};
+
+#endif
+
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "gl3renderer.h"
+#include "shadersources.h"
+#include "glstate.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+enum {
+	Corner,
+	Quad,
+	Cell = Quad,
+	Sprite,
+	Placement
+};
+
+// Every sprite image has to have this size to fit in the array.
+static const int spriteSize = 32;
+
+// One layer of the sprite array, the array stays bound to its target.
+class SpriteLayerTexture : public Texture
+{
+public:
+	SpriteLayerTexture(SpriteId sprite, GL3Renderer& renderer) : Texture(0), m_sprite(sprite), m_renderer(renderer) { }
+
+	void upload(const unsigned char *data, int width, int height)
+	{
+		if (width != spriteSize || height != spriteSize) {
+			std::cerr << "Sprite " << m_sprite << " is " << width << "x" << height
+				  << ", the gl3 renderer needs " << spriteSize << "x" << spriteSize << std::endl;
+		} else {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, m_sprite, width, height, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, data);
+			setLoaded(data, width, height);
+		}
+		m_renderer.spriteLoaded();
+	}
+
+private:
+	SpriteId m_sprite;
+	GL3Renderer& m_renderer;
+};
+
+GL3Renderer::GL3Renderer()
+	: m_tilesDrawn(0),
+	  m_tileOffset(0),
+	  m_quadOffset(0),
+	  m_quadArray(0),
+	  m_tileArray(0),
+	  m_cornerBuffer(0),
+	  m_indexBuffer(0),
+	  m_spriteArray(0),
+	  m_spritesPending(0),
+	  m_quads(0),
+	  m_drawCalls(0)
+{
+}
+
+GL3Renderer::~GL3Renderer()
+{
+	if (m_quadArray) {
+		const GLuint buffers[] = { m_cornerBuffer, m_indexBuffer };
+		glDeleteBuffers(2, buffers);
+		glDeleteVertexArrays(1, &m_quadArray);
+		glDeleteVertexArrays(1, &m_tileArray);
+		glDeleteTextures(1, &m_spriteArray);
+	}
+}
+
+static bool buildProgram(ShaderProgram& program, const char *vertexSource, const char *fragmentSource,
+			 const char *const *attribs, int attribCount)
+{
+	program.create();
+	if (!program.compile(GL_VERTEX_SHADER, vertexSource))
+		return false;
+
+	if (!program.compile(GL_FRAGMENT_SHADER, fragmentSource))
+		return false;
+
+	// Enables them too, on whatever vertex array is bound.
+	for (int i = 0; i < attribCount; ++i)
+		program.bindAttribLocation(i, attribs[i]);
+	if (!program.link()) {
+		std::cerr << "Failed to link the GL shader program: " << program.log() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool GL3Renderer::initialize()
+{
+	if (!GLEW_VERSION_3_3) {
+		std::cerr << "The gl3 renderer needs OpenGL 3.3." << std::endl;
+		return false;
+	}
+
+	// Same corners and triangles as the GL2 quads.
+	static const GLfloat corners[] = {
+		0, 0,
+		1, 0,
+		1, 1,
+		0, 1
+	};
+	static const GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	m_cornerBuffer = buffers[0];
+	m_indexBuffer = buffers[1];
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_cornerBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	// Core profile draws nothing without a vertex array, one per layout.
+	static const char *const quadAttribs[] = { "corner", "quad" };
+	glGenVertexArrays(1, &m_quadArray);
+	glBindVertexArray(m_quadArray);
+	if (!buildProgram(m_quadProgram, instancedVertexSource, instancedFragmentSource, quadAttribs, 2))
+		return false;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glVertexAttribPointer(Corner, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glVertexAttribDivisor(Quad, 1);
+
+	static const char *const tileAttribs[] = { "corner", "cell", "sprite", "placement" };
+	glGenVertexArrays(1, &m_tileArray);
+	glBindVertexArray(m_tileArray);
+	if (!buildProgram(m_tileProgram, tileVertexSource, tileFragmentSource, tileAttribs, 4))
+		return false;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glVertexAttribPointer(Corner, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glVertexAttribDivisor(Cell, 1);
+	glVertexAttribDivisor(Sprite, 1);
+	glVertexAttribDivisor(Placement, 1);
+
+	// Layer N holds sprite N, filtered like the other textures.  Only
+	// the top level counts until spriteLoaded() makes the rest.
+	glGenTextures(1, &m_spriteArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_spriteArray);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, spriteSize, spriteSize, SPRITE_COUNT, 0,
+		     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	// Enough for a full screen of tiles, it grows for more.
+	if (!m_stream.create(GL_ARRAY_BUFFER, 64 * 1024))
+		return false;
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	return true;
+}
+
+TexturePtr GL3Renderer::createSpriteTexture(SpriteId sprite)
+{
+	++m_spritesPending;
+	return TexturePtr(new SpriteLayerTexture(sprite, *this));
+}
+
+void GL3Renderer::spriteLoaded()
+{
+	// Every level has to be redone for each layer, so only after the last.
+	if (--m_spritesPending)
+		return;
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 1000);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void GL3Renderer::beginFrame()
+{
+	if (m_viewChanged) {
+		GLfloat matrix[9];
+		projectionMatrix(matrix);
+		glViewport(0, 0, m_width, m_height);
+		m_quadProgram.setProjectionMatrix(matrix);
+		m_tileProgram.setProjectionMatrix(matrix);
+		m_viewChanged = false;
+	}
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	m_quads = 0;
+	m_drawCalls = 0;
+}
+
+void GL3Renderer::submit(unsigned layer, const TexturePtr& texture, float x, float y,
+			 float size, uint8_t orientation)
+{
+	m_queue.submit(layer, &m_quadProgram, texture, x, y, size, orientation);
+	++m_quads;
+}
+
+void GL3Renderer::submitTile(unsigned layer, SpriteId sprite, const TexturePtr& texture, const GridPoint& pos)
+{
+	TileInstance tile = { GLshort(pos.x()), GLshort(pos.y()), spriteImage(sprite), spriteOrientation(sprite) };
+	addTile(layer, tile);
+}
+
+void GL3Renderer::submitSprite(unsigned layer, SpriteId sprite, const TexturePtr& texture, float x, float y)
+{
+	const int cellX = (int)std::floor(x / TILE_SIZE);
+	const int cellY = (int)std::floor(y / TILE_SIZE);
+	const int offsetX = (int)x - cellX * TILE_SIZE;
+	const int offsetY = (int)y - cellY * TILE_SIZE;
+	TileInstance tile = { GLshort(cellX), GLshort(cellY), spriteImage(sprite),
+			      GLushort(spriteOrientation(sprite) | offsetX << 4 | offsetY << 9) };
+	addTile(layer, tile);
+}
+
+void GL3Renderer::addTile(unsigned layer, const TileInstance& tile)
+{
+	if (layer >= m_tiles.size())
+		m_tiles.resize(layer + 1);
+
+	m_tiles[layer].push_back(tile);
+	++m_quads;
+}
+
+void GL3Renderer::endFrame()
+{
+	m_queue.flush();
+
+	size_t tiles = 0;
+	m_tileEnds.resize(m_tiles.size());
+	for (size_t layer = 0; layer < m_tiles.size(); ++layer) {
+		tiles += m_tiles[layer].size();
+		m_tileEnds[layer] = tiles;
+	}
+
+	const size_t tileBytes = tiles * sizeof(TileInstance);
+	const size_t quadBytes = m_queue.instances.size() * sizeof(GLfloat);
+	m_stream.begin(StreamBuffer::footprint(tileBytes) + StreamBuffer::footprint(quadBytes));
+
+	unsigned char *data = static_cast<unsigned char *>(m_stream.allocate(tileBytes, m_tileOffset));
+	for (const std::vector<TileInstance>& layer : m_tiles) {
+		if (!layer.empty())
+			memcpy(data, &layer[0], layer.size() * sizeof(TileInstance));
+		data += layer.size() * sizeof(TileInstance);
+	}
+
+	data = static_cast<unsigned char *>(m_stream.allocate(quadBytes, m_quadOffset));
+	if (quadBytes)
+		memcpy(data, &m_queue.instances[0], quadBytes);
+	m_stream.end();
+
+	m_tilesDrawn = 0;
+	for (const InstanceQueue::Batch& batch : m_queue.batches) {
+		drawTiles(batch.layer + 1);
+
+		glBindVertexArray(m_quadArray);
+		batch.program->bind();
+		batch.texture->bind();
+		glBindBuffer(GL_ARRAY_BUFFER, m_stream.id());
+		glVertexAttribPointer(Quad, 4, GL_FLOAT, GL_FALSE, 0,
+				      reinterpret_cast<const GLvoid *>(m_quadOffset + batch.first * 4 * sizeof(GLfloat)));
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, batch.count);
+		++m_drawCalls;
+	}
+	drawTiles(m_tiles.size());
+	m_stream.fence();
+
+	m_lastFrame.quads = m_quads;
+	m_lastFrame.drawCalls = m_drawCalls;
+	m_queue.instances.clear();
+	m_queue.batches.clear();
+	for (std::vector<TileInstance>& layer : m_tiles)
+		layer.clear();
+	g_glState.endFrame();
+}
+
+void GL3Renderer::drawTiles(size_t layerEnd)
+{
+	layerEnd = std::min(layerEnd, m_tileEnds.size());
+	const size_t end = layerEnd ? m_tileEnds[layerEnd - 1] : 0;
+	if (end <= m_tilesDrawn)
+		return;
+
+	glBindVertexArray(m_tileArray);
+	m_tileProgram.bind();
+	glBindBuffer(GL_ARRAY_BUFFER, m_stream.id());
+	const size_t offset = m_tileOffset + m_tilesDrawn * sizeof(TileInstance);
+	glVertexAttribIPointer(Cell, 2, GL_SHORT, sizeof(TileInstance),
+			       reinterpret_cast<const GLvoid *>(offset));
+	glVertexAttribIPointer(Sprite, 1, GL_UNSIGNED_SHORT, sizeof(TileInstance),
+			       reinterpret_cast<const GLvoid *>(offset + offsetof(TileInstance, sprite)));
+	glVertexAttribIPointer(Placement, 1, GL_UNSIGNED_SHORT, sizeof(TileInstance),
+			       reinterpret_cast<const GLvoid *>(offset + offsetof(TileInstance, placement)));
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, end - m_tilesDrawn);
+	++m_drawCalls;
+	m_tilesDrawn = end;
+}
+
+void GL3Renderer::InstanceQueue::draw(size_t begin, size_t end)
+{
+	// The tiles of a layer are drawn before its first batch, so a batch
+	// mustn't carry on into the next layer.
+	for (size_t i = begin; i < end; ++i) {
+		const unsigned layer = unsigned(m_commands[i].key >> 48);
+		if (i == begin || layer != batches.back().layer) {
+			batches.push_back(Batch { layer, m_commands[i].program, m_commands[i].texture, instances.size() / 4, 0 });
+			++m_drawCalls;
+		}
+
+		++batches.back().count;
+		instances.push_back(m_commands[i].x);
+		instances.push_back(m_commands[i].y);
+		instances.push_back(m_commands[i].size);
+		instances.push_back(m_commands[i].orientation);
+	}
+}
+
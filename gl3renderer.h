@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef GL3RENDERER_H
+#define GL3RENDERER_H
+
+#include "renderer.h"
+#include "shaderprogram.h"
+#include "renderqueue.h"
+#include "streambuffer.h"
+
+#include <vector>
+
+/*
+ * GL 3.3 core.  Map cells are a grid position, sprite and placement, the
+ * sprites live in one texture array so all tiles of a frame are a single
+ * instanced draw.  Other quads, the far away chunks, send position and
+ * size per instance and are drawn one batch per texture.  Both stream
+ * through the same ring buffer.
+ */
+class GL3Renderer : public Renderer
+{
+public:
+	GL3Renderer();
+	~GL3Renderer();
+
+	const char *name() const { return "gl3"; }
+	int glVersion() const { return 33; }
+	bool initialize();
+	TexturePtr createTexture() { return TexturePtr(new Texture); }
+	// A layer of the sprite array, only good for submitTile().
+	TexturePtr createSpriteTexture(SpriteId sprite);
+
+	void beginFrame();
+	void submit(unsigned layer, const TexturePtr& texture, float x, float y,
+		    float size = 32, uint8_t orientation = 0);
+	void submitTile(unsigned layer, SpriteId sprite, const TexturePtr& texture, const GridPoint& pos);
+	void submitSprite(unsigned layer, SpriteId sprite, const TexturePtr& texture, float x, float y);
+	void endFrame();
+
+private:
+	friend class SpriteLayerTexture;
+	// Mipmaps the sprite array once the last layer is in.
+	void spriteLoaded();
+
+	// Sorted and batched as usual, but only collected, endFrame() draws.
+	class InstanceQueue : public RenderQueue
+	{
+	public:
+		InstanceQueue() : RenderQueue(-1, -1, -1) { }
+
+		struct Batch {
+			unsigned layer;
+			ShaderProgram *program;
+			Texture *texture;
+			size_t first;
+			size_t count;
+		};
+
+		std::vector<GLfloat> instances;
+		std::vector<Batch> batches;
+
+	protected:
+		void draw(size_t begin, size_t end);
+	};
+
+	// The orientation in the low 4 bits of placement, then how many
+	// pixels right of and above the cell it goes, 5 bits each.
+	struct TileInstance {
+		GLshort x, y;
+		GLushort sprite;
+		GLushort placement;
+	};
+
+	void addTile(unsigned layer, const TileInstance& tile);
+
+	// Tiles of the layers below @layerEnd that are not drawn yet.
+	void drawTiles(size_t layerEnd);
+
+	ShaderProgram m_quadProgram;
+	ShaderProgram m_tileProgram;
+	InstanceQueue m_queue;
+	// One list per layer, uploaded one after the other.
+	std::vector<std::vector<TileInstance>> m_tiles;
+	std::vector<size_t> m_tileEnds;
+	size_t m_tilesDrawn;
+	// Where this frame's instances are in m_stream.
+	size_t m_tileOffset;
+	size_t m_quadOffset;
+
+	GLuint m_quadArray;
+	GLuint m_tileArray;
+	GLuint m_cornerBuffer;
+	GLuint m_indexBuffer;
+	StreamBuffer m_stream;
+	GLuint m_spriteArray;
+	// Layers created but not uploaded yet.
+	int m_spritesPending;
+	size_t m_quads;
+	size_t m_drawCalls;
+};
+
+#endif
+
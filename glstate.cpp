@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "glstate.h"
+
+#include <cstring>
+
+GLState g_glState;
+
+static const char *callNames[] = {
+	"glUseProgram",
+	"glBindTexture",
+	"glVertexAttribPointer",
+};
+
+GLState::GLState()
+{
+	invalidate();
+	memset(&m_frame, 0, sizeof(m_frame));
+	memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (m_program == program) {
+		++m_frame.avoided[CALL_USE_PROGRAM];
+		return;
+	}
+
+	glUseProgram(program);
+	m_program = program;
+	++m_frame.issued[CALL_USE_PROGRAM];
+}
+
+void GLState::bindTexture(GLuint texture)
+{
+	if (m_texture == texture) {
+		++m_frame.avoided[CALL_BIND_TEXTURE];
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	m_texture = texture;
+	++m_frame.issued[CALL_BIND_TEXTURE];
+}
+
+void GLState::vertexAttribPointer(GLuint location, GLint size, const GLvoid *pointer)
+{
+	// Client side arrays are only read at draw time, so the same
+	// pointer is the same state even if the contents changed.
+	if (location < MAX_ATTRIBS) {
+		AttribPointer& attrib = m_attribs[location];
+		if (attrib.size == size && attrib.pointer == pointer) {
+			++m_frame.avoided[CALL_ATTRIB_POINTER];
+			return;
+		}
+
+		attrib.size = size;
+		attrib.pointer = pointer;
+	}
+
+	glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, 0, pointer);
+	++m_frame.issued[CALL_ATTRIB_POINTER];
+}
+
+void GLState::programDeleted(GLuint program)
+{
+	if (m_program == program)
+		m_program = 0;
+}
+
+void GLState::textureDeleted(GLuint texture)
+{
+	// GL reverts the binding to 0 when a bound texture is deleted.
+	if (m_texture == texture)
+		m_texture = 0;
+}
+
+void GLState::invalidate()
+{
+	// Nothing is ever bound to these, the next call always goes through.
+	m_program = ~0u;
+	m_texture = ~0u;
+	for (AttribPointer& attrib : m_attribs) {
+		attrib.size = 0;
+		attrib.pointer = nullptr;
+	}
+}
+
+void GLState::endFrame()
+{
+	m_lastFrame = m_frame;
+	memset(&m_frame, 0, sizeof(m_frame));
+}
+
+std::ostream& operator<<(std::ostream& os, const GLState::Stats& stats)
+{
+	for (int i = 0; i < GLState::CALL_COUNT; ++i) {
+		os << callNames[i] << ": " << stats.issued[i] << " issued, "
+		   << stats.avoided[i] << " avoided";
+		if (i != GLState::CALL_COUNT - 1)
+			os << std::endl;
+	}
+	return os;
+}
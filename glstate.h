@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <ostream>
+
+/*
+ * Shadows the bits of GL state we change all the time, so that setting
+ * them to what they already are never reaches the driver.
+ * Anything that changes the same state behind our back must go through
+ * here too, or call invalidate() afterwards.
+ */
+class GLState
+{
+public:
+	enum Call {
+		CALL_USE_PROGRAM,
+		CALL_BIND_TEXTURE,
+		CALL_ATTRIB_POINTER,
+
+		CALL_COUNT
+	};
+
+	struct Stats {
+		unsigned issued[CALL_COUNT];
+		unsigned avoided[CALL_COUNT];
+	};
+
+	GLState();
+
+	void useProgram(GLuint program);
+	void bindTexture(GLuint texture);
+	void vertexAttribPointer(GLuint location, GLint size, const GLvoid *pointer);
+
+	void programDeleted(GLuint program);
+	void textureDeleted(GLuint texture);
+	void invalidate();
+
+	// Start counting a new frame, lastFrame() then holds the one that ended.
+	void endFrame();
+	const Stats& lastFrame() const { return m_lastFrame; }
+
+private:
+	enum { MAX_ATTRIBS = 8 };
+
+	struct AttribPointer {
+		GLint size;
+		const GLvoid *pointer;
+	};
+
+	GLuint m_program;
+	GLuint m_texture;
+	AttribPointer m_attribs[MAX_ATTRIBS];
+
+	Stats m_frame;
+	Stats m_lastFrame;
+};
+
+extern std::ostream& operator<<(std::ostream& os, const GLState::Stats& stats);
+
+extern GLState g_glState;
+
+#endif
+
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "headless.h"
+
+#include <EGL/eglext.h>
+#include <iostream>
+
+HeadlessContext::HeadlessContext()
+	: m_display(EGL_NO_DISPLAY),
+	  m_context(EGL_NO_CONTEXT),
+	  m_framebuffer(0),
+	  m_renderbuffer(0),
+	  m_width(0),
+	  m_height(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (m_framebuffer) {
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_renderbuffer);
+	}
+
+	if (m_display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (m_context != EGL_NO_CONTEXT)
+			eglDestroyContext(m_display, m_context);
+		eglTerminate(m_display);
+	}
+}
+
+bool HeadlessContext::create(int glVersion)
+{
+	// The surfaceless platform doesn't need X or a DRM device, fall back
+	// to whatever the default display is.
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+	if (m_display == EGL_NO_DISPLAY)
+		m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+		std::cerr << "Failed to initialize EGL." << std::endl;
+		m_display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cerr << "EGL can't do desktop OpenGL." << std::endl;
+		return false;
+	}
+
+	// Any surface type, the default asks for windows.
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configs;
+	if (!eglChooseConfig(m_display, configAttribs, &config, 1, &configs) || configs < 1) {
+		std::cerr << "No EGL config for OpenGL." << std::endl;
+		return false;
+	}
+
+	const EGLint coreAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, glVersion / 10,
+		EGL_CONTEXT_MINOR_VERSION_KHR, glVersion % 10,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, glVersion >= 32 ? coreAttribs : nullptr);
+	if (m_context == EGL_NO_CONTEXT) {
+		std::cerr << "Failed to create the EGL context: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+		return false;
+	}
+
+	// No surface at all, drawing goes to the framebuffer object.
+	if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+		std::cerr << "Failed to make the EGL context current, EGL_KHR_surfaceless_context is needed." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool HeadlessContext::createFramebuffer(int width, int height)
+{
+	if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object) {
+		std::cerr << "Framebuffer objects are not supported." << std::endl;
+		return false;
+	}
+
+	glGenRenderbuffers(1, &m_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Incomplete framebuffer of " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	return true;
+}
+
+void HeadlessContext::readPixels(unsigned char *rgba)
+{
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
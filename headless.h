@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <EGL/egl.h>
+
+/*
+ * A GL context with no window nor display server behind it, rendering
+ * into a framebuffer object instead.  Mesa's llvmpipe does the job on
+ * machines without a GPU.
+ */
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	// Makes the context current, GL functions can be loaded after.  See
+	// Renderer::glVersion() for @glVersion, 0 takes whatever is default.
+	bool create(int glVersion = 0);
+	// Needs GL 3.0 or ARB_framebuffer_object, binds it for drawing.
+	bool createFramebuffer(int width, int height);
+	// Bottom row first, as glReadPixels() hands them out.
+	void readPixels(unsigned char *rgba);
+
+private:
+	EGLDisplay m_display;
+	EGLContext m_context;
+	GLuint m_framebuffer;
+	GLuint m_renderbuffer;
+	int m_width;
+	int m_height;
+};
+
+#endif
+
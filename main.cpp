@@ -21,10 +21,20 @@
  */
 #include "game.h"
 #include "scheduler.h"
+#include "glstate.h"
+#include "headless.h"
+#include "png.h"
 
 #include <GLFW/glfw3.h>
 #include <ctime>
+#include <chrono>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 Game g_game;
 
@@ -42,6 +52,9 @@ static void keyPress(GLFWwindow *window, int key, int scancode, int action, int
 	case GLFW_KEY_ESCAPE:
 		glfwSetWindowShouldClose(window, GL_TRUE);
 		break;
+	case GLFW_KEY_F1:
+		std::cout << "GL calls last frame:" << std::endl << g_glState.lastFrame() << std::endl;
+		return;
 	case GLFW_KEY_UP:
 	case GLFW_KEY_W:
 	case GLFW_KEY_KP_8:
@@ -91,15 +104,269 @@ static void error_callback(int error, const char *description)
 	fputs(description, stderr);
 }
 
+static bool initGlew(bool headless)
+{
+	glewExperimental = GL_TRUE;
+	const GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLX builds of GLEW fail on a context without X after everything
+	// but the GLX entry points got loaded, which are not needed then.
+	if (headless && err == GLEW_ERROR_NO_GLX_DISPLAY)
+		return true;
+#endif
+	if (err != GLEW_OK) {
+		std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(err) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void printGlInfo()
+{
+	std::cout << "OpenGL Vendor:   " << glGetString(GL_VENDOR) << std::endl;
+	std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
+	std::cout << "OpenGL Version:  " << glGetString(GL_VERSION) << std::endl;
+}
+
+struct HeadlessOptions
+{
+	int width, height;
+	int frames;
+	float zoom;
+	std::string dumpDir;
+	// Draw with the CPU, no GL at all.
+	bool soft;
+	// Draw with GL and the CPU and count the pixels they disagree on.
+	bool compare;
+	// Seconds of play to get through before the first frame.
+	int fastForward;
+};
+
+// Game time headless frame @frame takes, whatever the real time is.  A
+// 60th of a second isn't a whole number of milliseconds, so it's 16 or 17
+// of them and the clock keeps in step with 60 Hz.
+static int64_t headlessFrameMs(int64_t frame)
+{
+	return (frame + 1) * 1000 / 60 - frame * 1000 / 60;
+}
+
+/*
+ * Renders a number of frames offscreen, no window needed, and tells how
+ * fast that went.  With a dump directory each frame is saved there.  The
+ * game runs on a clock of its own that moves a 60th of a second a frame,
+ * so the same options give the same frames.
+ */
+static int runHeadless(const HeadlessOptions& options)
+{
+	static ManualClock clock;
+	g_sched.setClock(&clock);
+
+	const int width = options.width;
+	const int height = options.height;
+	HeadlessContext context;
+	SoftRenderer soft;
+	Renderer *renderer = g_game.renderer();
+	const bool gl = !options.soft && renderer->glVersion();
+
+	if (options.soft)
+		g_game.setSoftRenderer(&soft);
+	else if (gl) {
+		if (!context.create(renderer->glVersion()) || !initGlew(true))
+			return 1;
+		printGlInfo();
+		if (!context.createFramebuffer(width, height))
+			return 1;
+	}
+
+	if (!g_game.initialize()) {
+		std::cerr << "Failed to initialize Game state" << std::endl;
+		return 1;
+	}
+	g_game.resize(width, height);
+	g_game.setZoom(options.zoom);
+
+	if (options.compare) {
+		soft.resize(width, height);
+		if (!soft.loadSprites())
+			return 1;
+	}
+
+	// Leave texture loading out of the numbers.
+	while (g_game.loading())
+		g_game.render();
+	if (gl)
+		glFinish();
+
+	if (options.fastForward) {
+		const auto start = std::chrono::steady_clock::now();
+		g_sched.advance(options.fastForward * 1000LL);
+		std::cout << "Fast-forwarded " << options.fastForward << " s of play in "
+			  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+			  << " ms" << std::endl;
+	}
+
+	const bool readBack = gl && (!options.dumpDir.empty() || options.compare);
+	std::vector<unsigned char> pixels(readBack ? (size_t)width * height * 4 : 0);
+	double renderSeconds = 0;
+	size_t differentPixels = 0;
+	int differentFrames = 0;
+	for (int frame = 0; frame < options.frames; ++frame) {
+		// render() may put down new food when done, so the CPU goes first.
+		g_sched.advance(headlessFrameMs(frame));
+		if (options.compare)
+			g_game.renderSoft(soft);
+
+		const auto start = std::chrono::steady_clock::now();
+		g_game.render();
+		if (gl)
+			glFinish();
+		renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const unsigned char *frameData = options.soft ? soft.pixels() : pixels.data();
+		if (readBack)
+			context.readPixels(pixels.data());
+
+		if (options.compare) {
+			size_t different = 0;
+			const uint32_t *a = reinterpret_cast<const uint32_t *>(pixels.data());
+			const uint32_t *b = reinterpret_cast<const uint32_t *>(soft.pixels());
+			for (size_t i = 0; i < (size_t)width * height; ++i)
+				different += a[i] != b[i];
+			differentPixels += different;
+			differentFrames += different != 0;
+		}
+
+		if (!options.dumpDir.empty() && (gl || options.soft)) {
+			char fileName[32];
+			snprintf(fileName, sizeof(fileName), "/frame-%05d.png", frame);
+			if (!writePng(options.dumpDir + fileName, frameData, width, height, true))
+				return 1;
+		}
+	}
+
+	std::cout << options.frames << " frames of " << width << "x" << height << " at zoom " << options.zoom
+		  << (options.soft ? " on the CPU: " : std::string(" with ") + renderer->name() + ": ")
+		  << options.frames / renderSeconds << " fps, " << renderSeconds * 1000 / options.frames << " ms a frame" << std::endl;
+	if (!options.soft)
+		std::cout << renderer->lastFrame().quads << " quads in " << renderer->lastFrame().drawCalls
+			  << " draw calls last frame" << std::endl;
+	if (gl)
+		std::cout << "GL calls last frame:" << std::endl << g_glState.lastFrame() << std::endl;
+	if (options.compare)
+		std::cout << "Software renderer: " << differentFrames << " frames and " << differentPixels
+			  << " pixels different from GL" << std::endl;
+	g_sched.stop();
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	GLFWwindow *window;
+	auto startTime = std::chrono::steady_clock::now();
+	auto elapsedMs = [startTime] () {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - startTime).count();
+	};
+
+	int worldCols = 0, worldRows = 0;
+	bool remote = false;
+	std::string rendererName = "gl2";
+	HeadlessOptions headless = { 0, 0, 300, 1.0f, "", false, false, 0 };
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--build-texture-cache")
+			return TextureCache::build(TEXTURE_CACHE, "textures") ? 0 : 1;
+		else if (arg == "--world" && i + 1 < argc) {
+			int cols, rows;
+			if (sscanf(argv[++i], "%dx%d", &cols, &rows) != 2 || cols <= 0 || rows <= 0
+			    || cols > 32767 || rows > 32767) {
+				std::cerr << "Invalid world size: " << argv[i] << ", expected COLSxROWS" << std::endl;
+				return 1;
+			}
+			worldCols = cols;
+			worldRows = rows;
+		} else if (arg == "--snakes" && i + 1 < argc) {
+			const int snakes = atoi(argv[++i]);
+			if (snakes <= 0) {
+				std::cerr << "Invalid number of snakes: " << argv[i] << std::endl;
+				return 1;
+			}
+			g_game.setAiSnakes(snakes);
+			// They need a world of their own, about 16 tiles each.
+			if (!worldCols)
+				worldCols = worldRows = std::min((int)std::ceil(std::sqrt(snakes * 16.0 + 1)), 32767);
+		} else if ((arg == "--connect" || arg == "--spectate") && i + 1 < argc) {
+			// HOST or HOST:PORT, the world is whatever the server has.
+			std::string host = argv[++i];
+			int port = arg == "--spectate" ? DEFAULT_SPECTATOR_PORT : DEFAULT_PORT;
+			const size_t colon = host.rfind(':');
+			if (colon != std::string::npos) {
+				port = atoi(host.c_str() + colon + 1);
+				host.erase(colon);
+			}
+			if (!g_game.connect(host, port))
+				return 1;
+			remote = true;
+		} else if (arg == "--headless" && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &headless.width, &headless.height) != 2
+			    || headless.width <= 0 || headless.height <= 0) {
+				std::cerr << "Invalid resolution: " << argv[i] << ", expected WIDTHxHEIGHT" << std::endl;
+				return 1;
+			}
+		} else if (arg == "--frames" && i + 1 < argc)
+			headless.frames = std::max(atoi(argv[++i]), 1);
+		else if (arg == "--zoom" && i + 1 < argc)
+			headless.zoom = std::min(std::max((float)atof(argv[++i]), 1.0f / 512.0f), 16.0f);
+		else if (arg == "--dump" && i + 1 < argc)
+			headless.dumpDir = argv[++i];
+		else if (arg == "--renderer" && i + 1 < argc)
+			rendererName = argv[++i];
+		else if (arg == "--soft")
+			headless.soft = true;
+		else if (arg == "--compare")
+			headless.compare = true;
+		else if (arg == "--fast-forward" && i + 1 < argc)
+			headless.fastForward = std::max(atoi(argv[++i]), 0);
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--build-texture-cache] [--world COLSxROWS] [--snakes N]"
+				  << " [--connect HOST[:PORT]] [--spectate HOST[:PORT]] [--renderer gl2|gl3|null]" << std::endl
+				  << "       [--headless WIDTHxHEIGHT [--frames N] [--zoom Z] [--dump DIR] [--soft | --compare]"
+				  << " [--fast-forward SECONDS]]"
+				  << std::endl;
+			return 1;
+		}
+	}
+	if (!remote)
+		g_game.setWorldSize(worldCols, worldRows);
+
+	Renderer *renderer = createRenderer(rendererName);
+	if (!renderer) {
+		std::cerr << "Unknown renderer: " << rendererName << ", expected gl2, gl3 or null" << std::endl;
+		return 1;
+	}
+	g_game.setRenderer(renderer);
+	// The game is only touched from this thread, once a frame.
+	g_sched.setDispatching(true);
+
+	if (headless.width) {
+		// Same food every run, so frames can be compared.
+		srand(0);
+		headless.compare = headless.compare && !headless.soft && renderer->glVersion();
+		return runHeadless(headless);
+	}
 
 	srand(std::time(nullptr));
 	glfwSetErrorCallback(error_callback);
 	if (!glfwInit())
 		return 1;
 
+	if (renderer->glVersion() >= 32) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, renderer->glVersion() / 10);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, renderer->glVersion() % 10);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	}
+
 	window = glfwCreateWindow(DEFAULT_WIDTH, DEFAULT_HEIGHT, "Snake", nullptr, nullptr);
 	if (!window) {
 		glfwTerminate();
@@ -114,24 +381,17 @@ int main(int argc, char **argv)
 				});
 	glfwSetScrollCallback(window,
 				[] (GLFWwindow *window, double x, double y) {
-					float newZoom = g_game.getZoom();
-					newZoom += (float)y / 4.f;
-					if (newZoom < 0)
-						newZoom = 1.0f;
+					// Multiply so that zooming far out on a big world
+					// takes as many clicks as zooming in.
+					float newZoom = g_game.getZoom() * std::pow(1.25f, (float)y);
+					newZoom = std::min(std::max(newZoom, 1.0f / 512.0f), 16.0f);
 					g_game.setZoom(newZoom);
 				});
 
 
-	glewExperimental = GL_TRUE;
-	const GLenum err = glewInit();
-	if (err != GLEW_OK) {
-		std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(err) << std::endl;
+	if (!initGlew(false))
 		return 1;
-	}
-
-	std::cout << "OpenGL Vendor:   " << glGetString(GL_VENDOR) << std::endl;
-	std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
-	std::cout << "OpenGL Version:  " << glGetString(GL_VERSION) << std::endl;
+	printGlInfo();
 
 	if (!g_game.initialize()) {
 		std::cerr << "Failed to initialize Game state" << std::endl;
@@ -142,9 +402,20 @@ int main(int argc, char **argv)
 	glfwGetFramebufferSize(window, &width, &height);
 	g_game.resize(width, height);
 
+	bool firstFrame = true;
+	bool loading = true;
 	while (!glfwWindowShouldClose(window)) {
+		g_sched.dispatch();
 		g_game.render();
 		glfwSwapBuffers(window);
+		if (firstFrame) {
+			std::cout << "Time to first frame: " << elapsedMs() << " ms" << std::endl;
+			firstFrame = false;
+		}
+		if (loading && !g_game.loading()) {
+			std::cout << "All textures loaded: " << elapsedMs() << " ms" << std::endl;
+			loading = false;
+		}
 		glfwPollEvents();
 	}
 
@@ -22,44 +22,124 @@
 #include "map.h"
 
 #include <algorithm>
-#include <assert.h>
+#include <cstdlib>
 
-void Map::addTile(const TilePtr& tile)
+void Map::resize(int cols, int rows, SpriteId ground)
 {
-	m_tiles.push_back(tile);
+	m_cols = cols;
+	m_rows = rows;
+	m_ground = ground;
 }
 
-void Map::removeTile(const Point& pos)
+bool Map::contains(const Point& pos) const
 {
-	auto it = std::find_if(m_tiles.begin(), m_tiles.end(),
-				[=] (const TilePtr& tile) -> bool { return tile->pos() == pos; } );
-	if (it != m_tiles.end())
-		m_tiles.erase(it);
+	return pos.x() >= 0 && pos.y() >= 0 && contains(GridPoint::fromPixels(pos));
 }
 
-TilePtr Map::getTile(const Point& pos) const
+const Chunk *Map::findChunk(const GridPoint& chunkPos) const
 {
-	auto it = std::find_if(m_tiles.begin(), m_tiles.end(),
-				[=] (const TilePtr& tile) -> bool { return tile->pos() == pos; } );
-	if (it != m_tiles.end())
-		return *it;
+	auto it = m_chunks.find(chunkPos);
+	if (it != m_chunks.end())
+		return it->second.get();
 	return nullptr;
 }
 
-TilePtr Map::getRandomTile() const
+SpriteId Map::sprite(const GridPoint& pos, TileLayer layer) const
 {
-	auto begin = m_tiles.begin();
-	auto end = m_tiles.end();
+	const Chunk *chunk = findChunk(chunkOf(pos));
+	if (!chunk)
+		return layer == LAYER_GROUND ? m_ground : SpriteId(SPRITE_NONE);
+	return chunk->layers[layer][cellOf(pos)];
+}
+
+void Map::setSprite(const GridPoint& pos, TileLayer layer, SpriteId sprite)
+{
+	const GridPoint chunkPos = chunkOf(pos);
+	auto it = m_chunks.find(chunkPos);
+	if (it == m_chunks.end()) {
+		if (sprite == (layer == LAYER_GROUND ? m_ground : SpriteId(SPRITE_NONE)))
+			return;		// Nothing would change.
+
+		Chunk *chunk = new Chunk;
+		std::fill_n(chunk->layers[LAYER_GROUND], CHUNK_SIZE * CHUNK_SIZE, m_ground);
+		for (int l = LAYER_GROUND + 1; l < LAYER_COUNT; ++l)
+			std::fill_n(chunk->layers[l], CHUNK_SIZE * CHUNK_SIZE, SPRITE_NONE);
+		chunk->version = 0;
+		it = m_chunks.emplace(chunkPos, std::unique_ptr<Chunk>(chunk)).first;
+	}
+
+	Chunk *chunk = it->second.get();
+	SpriteId& cell = chunk->layers[layer][cellOf(pos)];
+	if (cell == sprite)
+		return;
 
-	const unsigned long n = std::distance(begin, end);
-	const unsigned long divisor = RAND_MAX / n;
+	cell = sprite;
+	++chunk->version;
+	if (m_tracking)
+		m_changes.push_back(CellChange { pos, (uint8_t)layer, sprite }.key());
+}
+
+void Map::takeChanges(std::vector<CellChange>& changes)
+{
+	std::sort(m_changes.begin(), m_changes.end());
+	m_changes.erase(std::unique(m_changes.begin(), m_changes.end()), m_changes.end());
+
+	changes.clear();
+	changes.reserve(m_changes.size());
+	for (uint64_t key : m_changes) {
+		const TileLayer layer = static_cast<TileLayer>(key >> 32);
+		const GridPoint pos = GridPoint::fromMorton(key);
+		changes.push_back(CellChange { pos, (uint8_t)layer, sprite(pos, layer) });
+	}
+	m_changes.clear();
+}
+
+void Map::snapshot(std::vector<CellChange>& cells) const
+{
+	cells.clear();
+	for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+		const size_t begin = cells.size();
+		for (const auto& pair : m_chunks) {
+			const Chunk *chunk = pair.second.get();
+			const int baseX = pair.first.x() * CHUNK_SIZE;
+			const int baseY = pair.first.y() * CHUNK_SIZE;
+			const SpriteId empty = layer == LAYER_GROUND ? m_ground : SpriteId(SPRITE_NONE);
+
+			for (uint32_t cell = 0; cell < CHUNK_SIZE * CHUNK_SIZE; ++cell) {
+				const GridPoint local = GridPoint::fromMorton(cell);
+				const GridPoint pos(baseX + local.x(), baseY + local.y());
+				if (chunk->layers[layer][cell] != empty && contains(pos))
+					cells.push_back(CellChange { pos, (uint8_t)layer, chunk->layers[layer][cell] });
+			}
+		}
+		std::sort(cells.begin() + begin, cells.end(),
+			[] (const CellChange& a, const CellChange& b) { return a.key() < b.key(); });
+	}
+}
+
+bool Map::getRandomPos(const GridRect& area, Point& pos) const
+{
+	const int x0 = std::max(area.x, 0);
+	const int y0 = std::max(area.y, 0);
+	const int cols = std::min(area.x + area.cols, m_cols) - x0;
+	const int rows = std::min(area.y + area.rows, m_rows) - y0;
+	if (cols <= 0 || rows <= 0)
+		return false;
+
+	const unsigned long n = (unsigned long)cols * rows;
+	const unsigned long divisor = std::max(RAND_MAX / n, 1ul);
 
 	unsigned long k;
 	do
 		k = std::rand() / divisor;
 	while (k >= n);
 
-	std::advance(begin, k);
-	return *begin;
+	pos = GridPoint(x0 + k % cols, y0 + k / cols).toPixels();
+	return true;
 }
 
+void Map::clear()
+{
+	m_chunks.clear();
+	m_cols = m_rows = 0;
+}
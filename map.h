@@ -24,26 +24,174 @@
 
 #include "tile.h"
 
-#include <list>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
 
+// Side of a chunk in tiles.
+static constexpr int CHUNK_SIZE = 32;
+
+/* An area of the map in tiles.  */
+struct GridRect
+{
+	int x, y;
+	int cols, rows;
+
+	bool contains(const GridPoint& p) const
+	{
+		return p.x() >= x && p.y() >= y && p.x() < x + cols && p.y() < y + rows;
+	}
+};
+
+/*
+ * CHUNK_SIZE x CHUNK_SIZE tiles, one array of sprites per layer so that
+ * whoever is only interested in one layer (the renderer, the food logic)
+ * can stream through it.  Cells are stored in Z-order of their position
+ * inside the chunk, see GridPoint::morton().
+ */
+struct Chunk
+{
+	SpriteId layers[LAYER_COUNT][CHUNK_SIZE * CHUNK_SIZE];
+	// Bumped on every change, for whoever caches something built from it.
+	uint32_t version;
+};
+
+/* A cell as it is now, see Map::takeChanges().  */
+struct CellChange
+{
+	GridPoint pos;
+	uint8_t layer;
+	SpriteId sprite;
+
+	// By layer, then in Z-order so that neighbours stay close together.
+	uint64_t key() const { return (uint64_t)layer << 32 | pos.morton(); }
+};
+
+/*
+ * A grid of 32x32 tiles split in chunks.  Only chunks that had something
+ * put on them are allocated, the rest are just ground, so the map can be
+ * far bigger than what is ever looked at.  Chunks that fall outside after
+ * shrinking are kept around for when it grows back.
+ */
 class Map
 {
 public:
-	Map() { }
+	Map() : m_cols(0), m_rows(0), m_ground(SPRITE_NONE), m_tracking(false) { }
 	~Map() { clear(); }
 
-	void addTile(const TilePtr& tile);
-	void removeTile(const Point& pos);
-	void removeTile(const TilePtr& tile) { removeTile(tile->pos()); }
-	TilePtr getTile(const Point& pos) const;
-	TilePtr getRandomTile() const;
+	// Cells that were never set are @ground.
+	void resize(int cols, int rows, SpriteId ground);
+	int cols() const { return m_cols; }
+	int rows() const { return m_rows; }
+	GridRect bounds() const { return GridRect { 0, 0, m_cols, m_rows }; }
+	bool contains(const Point& pos) const;
+	bool contains(const GridPoint& pos) const { return bounds().contains(pos); }
 
-	inline void clear() { m_tiles.clear(); }
-	inline std::list<TilePtr> getTiles() const { return m_tiles; }
+	// Call @f(GridPoint, SpriteId) for every non empty cell of @layer
+	// inside @area, chunk by chunk, each in storage order.
+	template<typename F>
+	void forEachSprite(TileLayer layer, const GridRect& area, F f) const;
+	// Call @f(GridPoint chunkPos, const Chunk *) for every chunk that
+	// overlaps @area, the chunk is null if it's all ground.
+	template<typename F>
+	void forEachChunk(const GridRect& area, F f) const;
+	SpriteId ground() const { return m_ground; }
+
+	SpriteId sprite(const GridPoint& pos, TileLayer layer) const;
+	SpriteId sprite(const Point& pos, TileLayer layer) const { return sprite(GridPoint::fromPixels(pos), layer); }
+	void setSprite(const GridPoint& pos, TileLayer layer, SpriteId sprite);
+	void setSprite(const Point& pos, TileLayer layer, SpriteId sprite) { setSprite(GridPoint::fromPixels(pos), layer, sprite); }
+
+	// Remember the cells setSprite() changes, for whoever sends them over.
+	void trackChanges(bool track) { m_tracking = track; m_changes.clear(); }
+	// Moves what changed since the last call into @changes, each cell once
+	// with its current sprite, sorted by CellChange::key().
+	void takeChanges(std::vector<CellChange>& changes);
+	// Everything that isn't plain ground, in the same order.
+	void snapshot(std::vector<CellChange>& cells) const;
+
+	// False if @area is all off the map.
+	bool getRandomPos(const GridRect& area, Point& pos) const;
+
+	void clear();
 
 private:
-	std::list<TilePtr> m_tiles;
+	static GridPoint chunkOf(const GridPoint& pos) { return GridPoint(pos.x() / CHUNK_SIZE, pos.y() / CHUNK_SIZE); }
+	static uint32_t cellOf(const GridPoint& pos) { return GridPoint(pos.x() % CHUNK_SIZE, pos.y() % CHUNK_SIZE).morton(); }
+
+	const Chunk *findChunk(const GridPoint& chunkPos) const;
+
+	int m_cols;
+	int m_rows;
+	SpriteId m_ground;
+	bool m_tracking;
+	std::vector<uint64_t> m_changes;
+	std::unordered_map<GridPoint, std::unique_ptr<Chunk>> m_chunks;
 };
 
+template<typename F>
+void Map::forEachChunk(const GridRect& area, F f) const
+{
+	const int x0 = std::max(area.x, 0);
+	const int y0 = std::max(area.y, 0);
+	const int x1 = std::min(area.x + area.cols, m_cols);
+	const int y1 = std::min(area.y + area.rows, m_rows);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	for (int cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; ++cy)
+		for (int cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; ++cx)
+			f(GridPoint(cx, cy), findChunk(GridPoint(cx, cy)));
+}
+
+template<typename F>
+void Map::forEachSprite(TileLayer layer, const GridRect& area, F f) const
+{
+	const int x0 = std::max(area.x, 0);
+	const int y0 = std::max(area.y, 0);
+	const int x1 = std::min(area.x + area.cols, m_cols);
+	const int y1 = std::min(area.y + area.rows, m_rows);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	for (int cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; ++cy) {
+		for (int cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; ++cx) {
+			const int baseX = cx * CHUNK_SIZE;
+			const int baseY = cy * CHUNK_SIZE;
+			// Part of the area inside this chunk, in chunk coordinates.
+			const int lx0 = std::max(x0 - baseX, 0);
+			const int ly0 = std::max(y0 - baseY, 0);
+			const int lx1 = std::min(x1 - baseX, CHUNK_SIZE);
+			const int ly1 = std::min(y1 - baseY, CHUNK_SIZE);
+
+			const Chunk *chunk = findChunk(GridPoint(cx, cy));
+			if (!chunk) {
+				if (layer != LAYER_GROUND || m_ground == SPRITE_NONE)
+					continue;
+
+				for (int y = ly0; y < ly1; ++y)
+					for (int x = lx0; x < lx1; ++x)
+						f(GridPoint(baseX + x, baseY + y), m_ground);
+				continue;
+			}
+
+			// Z-order grows with both coordinates, so no cell past
+			// the bottom right one of the area can be inside it.
+			const SpriteId *cells = chunk->layers[layer];
+			const uint32_t begin = GridPoint(lx0, ly0).morton();
+			const uint32_t end = GridPoint(lx1 - 1, ly1 - 1).morton() + 1;
+			for (uint32_t i = begin; i < end; ++i) {
+				if (cells[i] == SPRITE_NONE)
+					continue;
+
+				const GridPoint cell = GridPoint::fromMorton(i);
+				if (cell.x() >= lx0 && cell.x() < lx1 && cell.y() >= ly0 && cell.y() < ly1)
+					f(GridPoint(baseX + cell.x(), baseY + cell.y()), cells[i]);
+			}
+		}
+	}
+}
+
 #endif
 
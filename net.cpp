@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "net.h"
+#include "protocol.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+// A client this far behind isn't coming back.
+static const size_t maxQueued = 16 << 20;
+// Buffers handed to the kernel at once.
+static const size_t maxIov = 64;
+
+static void setupSocket(int fd)
+{
+	// Ticks are small and must go out right away.
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+Connection::Connection(int fd)
+	: m_fd(fd), m_broken(false), m_inPos(0), m_outPos(0), m_queued(0)
+{
+	setupSocket(m_fd);
+}
+
+bool Connection::connect(const std::string& host, int port)
+{
+	close();
+
+	addrinfo hints, *result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	const int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result);
+	if (err) {
+		std::cerr << "Failed to resolve " << host << ": " << gai_strerror(err) << std::endl;
+		return false;
+	}
+
+	for (addrinfo *ai = result; ai && m_fd < 0; ai = ai->ai_next) {
+		m_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (m_fd >= 0 && ::connect(m_fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+			::close(m_fd);
+			m_fd = -1;
+		}
+	}
+	freeaddrinfo(result);
+
+	if (m_fd < 0) {
+		std::cerr << "Failed to connect to " << host << ":" << port << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	setupSocket(m_fd);
+	return true;
+}
+
+void Connection::close()
+{
+	if (m_fd >= 0)
+		::close(m_fd);
+	m_fd = -1;
+	m_broken = false;
+	m_in.clear();
+	m_inPos = 0;
+	m_out.clear();
+	m_outPos = 0;
+	m_queued = 0;
+}
+
+bool Connection::send(const SharedBuffer& buffer)
+{
+	if (m_fd < 0)
+		return false;
+	if (buffer->empty())
+		return true;
+	if (m_queued + buffer->size() > maxQueued)
+		return false;
+
+	m_out.push_back(buffer);
+	m_queued += buffer->size();
+	return flush();
+}
+
+bool Connection::flush()
+{
+	while (wantsWrite()) {
+		iovec iov[maxIov];
+		size_t count = 0;
+		size_t offset = m_outPos;
+		for (auto it = m_out.begin(); it != m_out.end() && count < maxIov; ++it, ++count) {
+			iov[count].iov_base = const_cast<uint8_t *>((*it)->data() + offset);
+			iov[count].iov_len = (*it)->size() - offset;
+			offset = 0;
+		}
+
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		ssize_t sent = ::sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			if (errno != EINTR)
+				return false;
+			continue;
+		}
+
+		m_queued -= sent;
+		while (sent > 0) {
+			const size_t left = m_out.front()->size() - m_outPos;
+			if ((size_t)sent < left) {
+				m_outPos += sent;
+				break;
+			}
+			sent -= left;
+			m_out.pop_front();
+			m_outPos = 0;
+		}
+	}
+	return true;
+}
+
+// More than two of the biggest messages unread is a peer flooding us.
+static const size_t maxInput = 2 * (4 + (size_t)MAX_MESSAGE_SIZE);
+
+bool Connection::receive()
+{
+	// Drop what was already handed out.
+	if (m_inPos) {
+		m_in.erase(m_in.begin(), m_in.begin() + m_inPos);
+		m_inPos = 0;
+	}
+
+	uint8_t buffer[65536];
+	for (;;) {
+		const ssize_t n = ::recv(m_fd, buffer, sizeof(buffer), 0);
+		if (n > 0) {
+			if (m_in.size() + n > maxInput) {
+				m_broken = true;
+				return false;
+			}
+			m_in.insert(m_in.end(), buffer, buffer + n);
+			continue;
+		}
+		if (n == 0)
+			return false;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return true;
+		if (errno != EINTR)
+			return false;
+	}
+}
+
+bool Connection::nextMessage(const uint8_t *&data, size_t& size)
+{
+	if (m_broken || m_in.size() - m_inPos < 4)
+		return false;
+
+	const uint8_t *p = &m_in[m_inPos];
+	const uint32_t length = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+	if (length == 0 || length > MAX_MESSAGE_SIZE) {
+		m_broken = true;
+		return false;
+	}
+	if (m_in.size() - m_inPos - 4 < length)
+		return false;
+
+	data = p + 4;
+	size = length;
+	m_inPos += 4 + length;
+	return true;
+}
+
+int listenTcp(int port)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		std::cerr << "Failed to listen on port " << port << ": " << strerror(errno) << std::endl;
+		::close(fd);
+		return -1;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+int boundPort(int fd)
+{
+	sockaddr_in addr;
+	socklen_t size = sizeof(addr);
+	if (getsockname(fd, (sockaddr *)&addr, &size) < 0)
+		return -1;
+	return ntohs(addr.sin_port);
+}
+
+int acceptTcp(int listenFd)
+{
+	return accept(listenFd, nullptr, nullptr);
+}
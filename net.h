@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef NET_H
+#define NET_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * An encoded message, shared by every connection it goes out on instead
+ * of copied into each.
+ */
+typedef std::shared_ptr<const std::vector<uint8_t>> SharedBuffer;
+
+/*
+ * A nonblocking TCP connection carrying the length prefixed messages of
+ * protocol.h.  TCP because a tick only says what changed since the one
+ * before, so losing or reordering one would leave the client off for good.
+ */
+class Connection
+{
+public:
+	Connection() : m_fd(-1), m_broken(false), m_inPos(0), m_outPos(0), m_queued(0) { }
+	explicit Connection(int fd);
+	~Connection() { close(); }
+
+	Connection(const Connection&) = delete;
+	Connection& operator=(const Connection&) = delete;
+
+	// Blocks until connected.
+	bool connect(const std::string& host, int port);
+	void close();
+	bool isOpen() const { return m_fd >= 0; }
+	int fd() const { return m_fd; }
+
+	// Queues @buffer and sends what the socket takes right away, the rest
+	// goes with flush().  False once too much piled up for a peer that
+	// doesn't read.
+	bool send(const SharedBuffer& buffer);
+	bool send(const std::vector<uint8_t>& data) { return send(std::make_shared<const std::vector<uint8_t>>(data)); }
+	// Everything queued goes out in one writev() style call.
+	bool flush();
+	bool wantsWrite() const { return !m_out.empty(); }
+	size_t queued() const { return m_queued; }
+
+	// Reads whatever arrived, false on EOF or error.  Too much unread
+	// input breaks the connection.
+	bool receive();
+	// The next complete message (type and payload), valid until the next
+	// receive().  False if there is none yet.
+	bool nextMessage(const uint8_t *&data, size_t& size);
+	// Set if the peer sent something not to be trusted.
+	bool broken() const { return m_broken; }
+
+private:
+	int m_fd;
+	bool m_broken;
+	std::vector<uint8_t> m_in;
+	size_t m_inPos;
+	std::deque<SharedBuffer> m_out;
+	// How much of the first buffer went out already.
+	size_t m_outPos;
+	size_t m_queued;
+};
+
+// A nonblocking socket listening on @port (0 picks one), -1 on error.
+int listenTcp(int port);
+int boundPort(int fd);
+// -1 if nobody is waiting.
+int acceptTcp(int listenFd);
+
+#endif
+
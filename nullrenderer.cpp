@@ -19,38 +19,25 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-#include "tile.h"
+#include "nullrenderer.h"
 
-#include <algorithm>
-
-Tile::Tile(const Point& pos)
-	: m_pos(pos)
+// Keeps what Texture works out from the pixels, uploads them nowhere.
+class NullTexture : public Texture
 {
+public:
+	NullTexture() : Texture(0) { }
 
-}
+	void upload(const unsigned char *data, int width, int height) { setLoaded(data, width, height); }
+};
 
-Tile::~Tile()
+TexturePtr NullRenderer::createTexture()
 {
-	m_textures.clear();
+	return TexturePtr(new NullTexture);
 }
 
-void Tile::addTexture(const TexturePtr& texture)
+void NullRenderer::endFrame()
 {
-	m_textures.push_back(texture);
-}
-
-void Tile::removeTexture(const TexturePtr& texture)
-{
-	auto it = std::find_if(m_textures.begin(), m_textures.end(),
-				[=] (const TexturePtr& tex) { return tex->id() == texture->id(); } );
-	if (it != m_textures.end())
-		m_textures.erase(it);
-}
-
-TexturePtr Tile::popTexture()
-{	
-	auto it = m_textures.end() - 1;
-	m_textures.erase(it);
-	return *it;
+	m_lastFrame.quads = m_quads;
+	m_lastFrame.drawCalls = 0;
 }
 
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef NULLRENDERER_H
+#define NULLRENDERER_H
+
+#include "renderer.h"
+
+/*
+ * Draws nothing and needs no GL, it only counts what is submitted.  Makes
+ * it possible to time the game side of a frame on its own.
+ */
+class NullRenderer : public Renderer
+{
+public:
+	NullRenderer() : m_quads(0) { }
+
+	const char *name() const { return "null"; }
+	int glVersion() const { return 0; }
+	bool initialize() { return true; }
+	TexturePtr createTexture();
+
+	void beginFrame() { m_quads = 0; }
+	void submit(unsigned layer, const TexturePtr& texture, float x, float y,
+		    float size = 32, uint8_t orientation = 0) { ++m_quads; }
+	void endFrame();
+
+private:
+	size_t m_quads;
+};
+
+#endif
+
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "png.h"
+
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+	static uint32_t table[256];
+	if (!table[1]) {
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v)
+{
+	out.push_back(v >> 24);
+	out.push_back(v >> 16);
+	out.push_back(v >> 8);
+	out.push_back(v);
+}
+
+static void putChunk(std::vector<uint8_t>& out, const char *type, const std::vector<uint8_t>& data)
+{
+	putU32(out, data.size());
+	const size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	putU32(out, crc32(&out[start], out.size() - start));
+}
+
+bool writePng(const std::string& fileName, const uint8_t *rgba, int width, int height, bool bottomUp)
+{
+	// Every row starts with filter type 0 (none).
+	const size_t stride = (size_t)width * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((stride + 1) * height);
+	for (int y = 0; y < height; ++y) {
+		const uint8_t *row = rgba + stride * (bottomUp ? height - 1 - y : y);
+		raw.push_back(0);
+		raw.insert(raw.end(), row, row + stride);
+	}
+
+	// zlib stream made of stored deflate blocks, those hold 64k at most.
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	for (size_t pos = 0; pos < raw.size() || raw.empty(); ) {
+		const size_t size = std::min<size_t>(raw.size() - pos, 65535);
+		const bool last = pos + size == raw.size();
+		zlib.push_back(last);
+		zlib.push_back(size);
+		zlib.push_back(size >> 8);
+		zlib.push_back(~size);
+		zlib.push_back(~size >> 8);
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + size);
+		pos += size;
+		if (last)
+			break;
+	}
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	putU32(zlib, b << 16 | a);
+
+	std::vector<uint8_t> header;
+	putU32(header, width);
+	putU32(header, height);
+	header.push_back(8);	// Bits per channel
+	header.push_back(6);	// RGBA
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	putChunk(png, "IHDR", header);
+	putChunk(png, "IDAT", zlib);
+	putChunk(png, "IEND", std::vector<uint8_t>());
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char *>(png.data()), png.size())) {
+		std::cerr << "Failed to write " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -29,3 +29,11 @@ std::ostream& operator<<(std::ostream& os, const Point& p)
 	return os;
 }
 
+std::ostream& operator<<(std::ostream& os, const GridPoint& p)
+{
+	os << "GridPoint(";
+	os << p.x() << ", " << p.y();
+	os << ")";
+	return os;
+}
+
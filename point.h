@@ -24,6 +24,11 @@
 
 #include <array>
 #include <ostream>
+#include <functional>
+#include <cstdint>
+
+// Size of a tile in pixels.
+static constexpr int TILE_SIZE = 32;
 
 template<typename T>
 class TPoint
@@ -33,32 +38,27 @@ private:
 
 public:
 
-	TPoint()
+	constexpr TPoint()
 		: m_x(0), m_y(0)
 	{
 	}
-	TPoint(const T& x, const T& y)
+	constexpr TPoint(const T& x, const T& y)
 		: m_x(x), m_y(y)
 	{
 	}
 
-	T x() const { return m_x; }
-	T y() const { return m_y; }
-
-	TPoint<T>& operator=(const TPoint<T>& other) {
-		m_x = other.m_x;
-		m_y = other.m_y;
-		return *this;
-	}
+	constexpr T x() const { return m_x; }
+	constexpr T y() const { return m_y; }
 
 	bool operator==(const TPoint<T>& other) const {
 		return other.m_x == m_x && other.m_y == m_y;	
 	}
 	bool operator!=(const TPoint<T>& other) const {
-		return other.m_x != m_x && other.m_y != m_y;
+		return !(*this == other);
 	}
+	// Row major, so sorted points go the way the map is read.
 	bool operator<(const TPoint<T>& other) const {
-		return m_x < other.m_x && m_y < other.m_y;
+		return m_y < other.m_y || (m_y == other.m_y && m_x < other.m_x);
 	}
 
 	void checkBounds(int maxX, int maxY)
@@ -77,7 +77,71 @@ public:
 
 typedef TPoint<int> Point;
 
+/*
+ * A tile position (column, row) packed in 32 bits.  morton() interleaves
+ * the bits of both coordinates (Z-order) so that tiles close on the grid
+ * end up close in memory when stored by it.
+ */
+class GridPoint
+{
+public:
+	constexpr GridPoint()
+		: m_x(0), m_y(0)
+	{
+	}
+	constexpr GridPoint(int x, int y)
+		: m_x(x), m_y(y)
+	{
+	}
+
+	static constexpr GridPoint fromPixels(const Point& p) { return GridPoint(p.x() / TILE_SIZE, p.y() / TILE_SIZE); }
+	constexpr Point toPixels() const { return Point(m_x * TILE_SIZE, m_y * TILE_SIZE); }
+
+	static GridPoint fromMorton(uint32_t code) { return GridPoint(compactBits(code), compactBits(code >> 1)); }
+	uint32_t morton() const { return spreadBits((uint16_t)m_x) | spreadBits((uint16_t)m_y) << 1; }
+
+	constexpr int x() const { return m_x; }
+	constexpr int y() const { return m_y; }
+	constexpr uint32_t packed() const { return (uint32_t)(uint16_t)m_y << 16 | (uint16_t)m_x; }
+
+	constexpr bool operator==(const GridPoint& other) const { return packed() == other.packed(); }
+	constexpr bool operator!=(const GridPoint& other) const { return packed() != other.packed(); }
+	constexpr bool operator<(const GridPoint& other) const { return m_y < other.m_y || (m_y == other.m_y && m_x < other.m_x); }
+
+	// 0b1111 -> 0b01010101
+	static uint32_t spreadBits(uint32_t v)
+	{
+		v = (v | (v << 8)) & 0x00FF00FF;
+		v = (v | (v << 4)) & 0x0F0F0F0F;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+	static uint32_t compactBits(uint32_t v)
+	{
+		v &= 0x55555555;
+		v = (v | (v >> 1)) & 0x33333333;
+		v = (v | (v >> 2)) & 0x0F0F0F0F;
+		v = (v | (v >> 4)) & 0x00FF00FF;
+		v = (v | (v >> 8)) & 0x0000FFFF;
+		return v;
+	}
+
+private:
+	int16_t m_x, m_y;
+};
+
+namespace std {
+	template<> struct hash<Point> {
+		size_t operator()(const Point& p) const { return hash<uint64_t>()((uint64_t)(uint32_t)p.y() << 32 | (uint32_t)p.x()); }
+	};
+	template<> struct hash<GridPoint> {
+		size_t operator()(const GridPoint& p) const { return hash<uint32_t>()(p.packed()); }
+	};
+}
+
 extern std::ostream& operator<<(std::ostream& os, const Point& p);
+extern std::ostream& operator<<(std::ostream& os, const GridPoint& p);
 
 #endif
 
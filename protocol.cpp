@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "protocol.h"
+
+void MessageWriter::begin(MessageType type)
+{
+	m_start = m_out.size();
+	u32(0);		// Filled in by end().
+	u8(type);
+}
+
+void MessageWriter::end()
+{
+	const uint32_t size = m_out.size() - m_start - 4;
+	for (int i = 0; i < 4; ++i)
+		m_out[m_start + i] = size >> (i * 8);
+}
+
+void MessageWriter::u16(uint16_t v)
+{
+	m_out.push_back(v);
+	m_out.push_back(v >> 8);
+}
+
+void MessageWriter::u32(uint32_t v)
+{
+	for (int i = 0; i < 4; ++i)
+		m_out.push_back(v >> (i * 8));
+}
+
+void MessageWriter::varint(uint32_t v)
+{
+	// 7 bits at a time, the high bit says more follow.
+	while (v >= 0x80) {
+		m_out.push_back(v | 0x80);
+		v >>= 7;
+	}
+	m_out.push_back(v);
+}
+
+uint8_t MessageReader::u8()
+{
+	if (m_pos == m_end) {
+		m_ok = false;
+		return 0;
+	}
+	return *m_pos++;
+}
+
+uint16_t MessageReader::u16()
+{
+	uint16_t v = u8();
+	return v | u8() << 8;
+}
+
+uint32_t MessageReader::u32()
+{
+	uint32_t v = 0;
+	for (int i = 0; i < 4; ++i)
+		v |= (uint32_t)u8() << (i * 8);
+	return v;
+}
+
+uint32_t MessageReader::varint()
+{
+	uint32_t v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		const uint8_t byte = u8();
+		v |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return v;
+	}
+
+	m_ok = false;
+	return 0;
+}
+
+void writeWelcome(std::vector<uint8_t>& out, const Map& map, SnakeId snake)
+{
+	MessageWriter w(out);
+	w.begin(MSG_WELCOME);
+	w.u16(PROTOCOL_VERSION);
+	w.u16(map.cols());
+	w.u16(map.rows());
+	w.u16(map.ground());
+	w.u32(snake);
+	w.end();
+}
+
+void writeState(std::vector<uint8_t>& out, MessageType type, uint32_t tick,
+		const std::vector<SnakeHead>& heads, const std::vector<CellChange>& cells)
+{
+	MessageWriter w(out);
+	w.begin(type);
+	w.u32(tick);
+
+	w.varint(heads.size());
+	for (const SnakeHead& head : heads) {
+		w.varint(head.id);
+		w.u16(head.pos.x());
+		w.u16(head.pos.y());
+	}
+
+	// Per layer a count, then each cell as (code - previous code, sprite).
+	auto it = cells.begin();
+	for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+		auto end = it;
+		while (end != cells.end() && end->layer == layer)
+			++end;
+
+		w.varint(end - it);
+		uint32_t previous = 0;
+		for (; it != end; ++it) {
+			const uint32_t code = it->pos.morton();
+			w.varint(code - previous);
+			w.varint(it->sprite);
+			previous = code;
+		}
+	}
+	w.end();
+}
+
+void writeInput(std::vector<uint8_t>& out, Direction_t dir)
+{
+	MessageWriter w(out);
+	w.begin(MSG_INPUT);
+	w.u8(dir);
+	w.end();
+}
+
+bool readState(MessageReader& in, uint32_t& tick, std::vector<SnakeHead>& heads,
+	       std::vector<CellChange>& cells)
+{
+	tick = in.u32();
+
+	heads.clear();
+	const uint32_t headCount = in.varint();
+	for (uint32_t i = 0; i < headCount && in.ok(); ++i) {
+		SnakeHead head;
+		head.id = in.varint();
+		const int16_t x = in.u16();
+		const int16_t y = in.u16();
+		head.pos = GridPoint(x, y);
+		heads.push_back(head);
+	}
+
+	cells.clear();
+	for (int layer = 0; layer < LAYER_COUNT && in.ok(); ++layer) {
+		const uint32_t count = in.varint();
+		uint32_t code = 0;
+		for (uint32_t i = 0; i < count && in.ok(); ++i) {
+			code += in.varint();
+			const SpriteId sprite = in.varint();
+			cells.push_back(CellChange { GridPoint::fromMorton(code), (uint8_t)layer, sprite });
+		}
+	}
+
+	return in.ok() && in.atEnd();
+}
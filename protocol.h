@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "world.h"
+
+#include <vector>
+
+static constexpr uint16_t PROTOCOL_VERSION = 2;
+static constexpr int DEFAULT_PORT = 7777;
+static constexpr int DEFAULT_SPECTATOR_PORT = 7778;
+// Anything bigger is taken as garbage and the connection dropped.
+static constexpr uint32_t MAX_MESSAGE_SIZE = 64 << 20;
+
+/*
+ * Every message is a little endian uint32 length followed by that many
+ * bytes: the type and the payload.
+ *
+ * The server sends MSG_WELCOME and a MSG_SNAPSHOT of the whole map to
+ * whoever joins, then a MSG_TICK per tick with only the cells that changed
+ * since the one before.  Positions are sent as the difference to the
+ * previous cell's Z-order code, so changes that are close together (a
+ * snake leaving one tile for the next) take a byte or two each.
+ */
+enum MessageType : uint8_t {
+	MSG_WELCOME = 1,	// version, cols, rows, ground sprite, your snake or NO_SNAKE
+	MSG_SNAPSHOT,		// tick, heads, every non ground cell
+	MSG_TICK,		// tick, heads, cells changed since the last tick
+	MSG_INPUT		// direction, client to server
+};
+
+/* Where a player's snake is, so that clients can follow their own.  */
+struct SnakeHead
+{
+	SnakeId id;
+	GridPoint pos;
+};
+
+class MessageWriter
+{
+public:
+	explicit MessageWriter(std::vector<uint8_t>& out) : m_out(out), m_start(0) { }
+
+	void begin(MessageType type);
+	void end();
+
+	void u8(uint8_t v) { m_out.push_back(v); }
+	void u16(uint16_t v);
+	void u32(uint32_t v);
+	void varint(uint32_t v);
+
+private:
+	std::vector<uint8_t>& m_out;
+	size_t m_start;
+};
+
+/* Reads one message, ok() turns false on running past the end.  */
+class MessageReader
+{
+public:
+	MessageReader(const uint8_t *data, size_t size) : m_pos(data), m_end(data + size), m_ok(true) { }
+
+	uint8_t u8();
+	uint16_t u16();
+	uint32_t u32();
+	uint32_t varint();
+
+	bool ok() const { return m_ok; }
+	bool atEnd() const { return m_pos == m_end; }
+
+private:
+	const uint8_t *m_pos;
+	const uint8_t *m_end;
+	bool m_ok;
+};
+
+void writeWelcome(std::vector<uint8_t>& out, const Map& map, SnakeId snake);
+// @cells must be sorted by CellChange::key().
+void writeState(std::vector<uint8_t>& out, MessageType type, uint32_t tick,
+		const std::vector<SnakeHead>& heads, const std::vector<CellChange>& cells);
+void writeInput(std::vector<uint8_t>& out, Direction_t dir);
+
+// What follows the type of a MSG_SNAPSHOT or MSG_TICK.
+bool readState(MessageReader& in, uint32_t& tick, std::vector<SnakeHead>& heads,
+	       std::vector<CellChange>& cells);
+
+#endif
+
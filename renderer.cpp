@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "renderer.h"
+#include "gl2renderer.h"
+#include "gl3renderer.h"
+#include "nullrenderer.h"
+
+Renderer::Renderer()
+	: m_width(0),
+	  m_height(0),
+	  m_cameraX(0.0f),
+	  m_cameraY(0.0f),
+	  m_zoom(1.0f),
+	  m_viewChanged(true)
+{
+	m_lastFrame.quads = 0;
+	m_lastFrame.drawCalls = 0;
+}
+
+void Renderer::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_viewChanged = true;
+}
+
+void Renderer::setView(float cameraX, float cameraY, float zoom)
+{
+	m_cameraX = cameraX;
+	m_cameraY = cameraY;
+	m_zoom = zoom;
+	m_viewChanged = true;
+}
+
+void Renderer::projectionMatrix(float matrix[9]) const
+{
+	float sx = 2.0f/m_width*m_zoom;
+	float sy = 2.0f/m_height*m_zoom;
+	//  Coordinate      Projection Matrix			        GL Coordinate (Transformed)
+	//                  | sx           |  0.0            | 0.0  |
+	//  | x  y  1 |  *  | 0.0          |  sy             | 0.0  | =  | x' y' 1 |
+	//                  | -camera.x*sx | -camera.y*sy    | 1.0  |
+	const float values[] = {
+		 sx,		  0.0f,		 0.0f,
+		 0.0f,		  sy,		 0.0f,
+		-m_cameraX*sx,	 -m_cameraY*sy,	 1.0f
+	};
+
+	for (int i = 0; i < 9; ++i)
+		matrix[i] = values[i];
+}
+
+void Renderer::submitSprite(unsigned layer, SpriteId sprite, const TexturePtr& texture, float x, float y)
+{
+	submit(layer, texture, x, y, TILE_SIZE, spriteOrientation(sprite));
+}
+
+void Renderer::submitTile(unsigned layer, SpriteId sprite, const TexturePtr& texture, const GridPoint& pos)
+{
+	const Point pixels = pos.toPixels();
+	submit(layer, texture, pixels.x(), pixels.y(), TILE_SIZE, spriteOrientation(sprite));
+}
+
+Renderer *createRenderer(const std::string& name)
+{
+	if (name == "gl2")
+		return new GL2Renderer;
+	if (name == "gl3")
+		return new GL3Renderer;
+	if (name == "null")
+		return new NullRenderer;
+	return nullptr;
+}
+
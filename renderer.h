@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "texture.h"
+#include "sprites.h"
+#include "point.h"
+
+#include <string>
+#include <cstddef>
+
+/*
+ * Everything Game draws goes through here.  Quads are submitted between
+ * beginFrame() and endFrame() in any order, lower layers end up below and
+ * within a layer the submission order is kept.
+ */
+class Renderer
+{
+public:
+	struct Stats {
+		size_t quads;
+		size_t drawCalls;
+	};
+
+	Renderer();
+	virtual ~Renderer() { }
+
+	virtual const char *name() const = 0;
+	// GL version the context has to be made with, major * 10 + minor and
+	// a core profile from 32 on.  0 when it doesn't need GL at all.
+	virtual int glVersion() const = 0;
+	virtual bool initialize() = 0;
+	virtual TexturePtr createTexture() = 0;
+	// For the map's sprites, which are drawn with submitTile() and
+	// submitSprite().
+	virtual TexturePtr createSpriteTexture(SpriteId sprite) { return createTexture(); }
+
+	void resize(int width, int height);
+	// World pixel (@cameraX, @cameraY) ends up in the middle.
+	void setView(float cameraX, float cameraY, float zoom);
+
+	virtual void beginFrame() = 0;
+	// @orientation as spriteOrientation() has it.
+	virtual void submit(unsigned layer, const TexturePtr& texture, float x, float y,
+			    float size = 32, uint8_t orientation = 0) = 0;
+	// A map cell, @texture is what createSpriteTexture(spriteImage(@sprite)) gave.
+	// Within a layer tiles may go below the other quads.
+	virtual void submitTile(unsigned layer, SpriteId sprite, const TexturePtr& texture, const GridPoint& pos);
+	// Same, only off the grid at whole pixels (@x, @y).
+	virtual void submitSprite(unsigned layer, SpriteId sprite, const TexturePtr& texture, float x, float y);
+	virtual void endFrame() = 0;
+
+	const Stats& lastFrame() const { return m_lastFrame; }
+
+protected:
+	// Column major, world pixels to clip space.
+	void projectionMatrix(float matrix[9]) const;
+
+	int m_width;
+	int m_height;
+	float m_cameraX;
+	float m_cameraY;
+	float m_zoom;
+	// Set by resize() and setView(), backends clear it once applied.
+	bool m_viewChanged;
+	Stats m_lastFrame;
+};
+
+// "gl2", "gl3" or "null", nullptr for anything else.
+extern Renderer *createRenderer(const std::string& name);
+
+#endif
+
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "renderqueue.h"
+
+#include <cstring>
+
+// 4 vertices per quad and GLushort indices.
+static const size_t maxBatchQuads = 65536 / 4;
+
+RenderQueue::RenderQueue(GLint vertexLocation, GLint texCoordLocation, GLint orientationLocation)
+	: m_drawCalls(0),
+	  m_vertexLocation(vertexLocation),
+	  m_texCoordLocation(texCoordLocation),
+	  m_orientationLocation(orientationLocation)
+{
+}
+
+void RenderQueue::submit(unsigned layer, ShaderProgram *program, const TexturePtr& texture, float x, float y,
+			 float size, uint8_t orientation)
+{
+	Command command;
+	command.key = makeKey(layer, program->id(), texture->id());
+	command.program = program;
+	command.texture = texture.get();
+	command.x = x;
+	command.y = y;
+	command.size = size;
+	command.orientation = orientation;
+	m_commands.push_back(command);
+}
+
+void RenderQueue::flush()
+{
+	sort();
+
+	m_drawCalls = 0;
+	size_t begin = 0;
+	for (size_t i = 1; i <= m_commands.size(); ++i) {
+		if (i == m_commands.size()
+		    || m_commands[i].program != m_commands[begin].program
+		    || m_commands[i].texture != m_commands[begin].texture
+		    || i - begin == maxBatchQuads) {
+			draw(begin, i);
+			begin = i;
+		}
+	}
+
+	m_commands.clear();
+}
+
+void RenderQueue::sort()
+{
+	// LSD radix sort, a byte at a time, it's stable so submission
+	// order is kept between equal keys.  Bytes that are the same
+	// for every command (most of them) are skipped.
+	const size_t n = m_commands.size();
+	if (n < 2)
+		return;
+
+	m_scratch.resize(n);
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t count[256];
+		memset(count, 0, sizeof(count));
+		for (const Command& command : m_commands)
+			++count[(command.key >> shift) & 0xFF];
+
+		if (count[(m_commands[0].key >> shift) & 0xFF] == n)
+			continue;
+
+		size_t offset = 0;
+		for (size_t& c : count) {
+			size_t tmp = c;
+			c = offset;
+			offset += tmp;
+		}
+
+		for (const Command& command : m_commands)
+			m_scratch[count[(command.key >> shift) & 0xFF]++] = command;
+		m_commands.swap(m_scratch);
+	}
+}
+
+void RenderQueue::draw(size_t begin, size_t end)
+{
+	const size_t quads = end - begin;
+	if (!quads)
+		return;
+
+	m_vertices.resize(quads * 8);
+	m_orientations.resize(quads * 4);
+	GLfloat *vertex = &m_vertices[0];
+	GLfloat *orientation = &m_orientations[0];
+	for (size_t i = begin; i < end; ++i) {
+		const GLfloat x = m_commands[i].x;
+		const GLfloat y = m_commands[i].y;
+		const GLfloat size = m_commands[i].size;
+
+		*vertex++ = x;		*vertex++ = y;
+		*vertex++ = x + size;	*vertex++ = y;
+		*vertex++ = x + size;	*vertex++ = y + size;
+		*vertex++ = x;		*vertex++ = y + size;
+
+		for (int corner = 0; corner < 4; ++corner)
+			*orientation++ = m_commands[i].orientation;
+	}
+
+	// These two only ever grow, every quad uses the same pattern.
+	if (m_indices.size() < quads * 6) {
+		size_t first = m_indices.size() / 6;
+		m_indices.resize(quads * 6);
+		m_texCoords.resize(quads * 8);
+		for (size_t q = first; q < quads; ++q) {
+			static const GLfloat texcoord[] = {
+				0, 0,
+				1, 0,
+				1, 1,
+				0, 1
+			};
+			const GLushort base = q * 4;
+			const GLushort indices[] = {
+				GLushort(base), GLushort(base + 1), GLushort(base + 2),
+				GLushort(base), GLushort(base + 2), GLushort(base + 3)
+			};
+
+			memcpy(&m_indices[q * 6], indices, sizeof(indices));
+			memcpy(&m_texCoords[q * 8], texcoord, sizeof(texcoord));
+		}
+	}
+
+	ShaderProgram *program = m_commands[begin].program;
+	program->bind();
+	program->setVertexData(m_vertexLocation, &m_vertices[0], 2);
+	program->setVertexData(m_texCoordLocation, &m_texCoords[0], 2);
+	program->setVertexData(m_orientationLocation, &m_orientations[0], 1);
+
+	m_commands[begin].texture->bind();
+	glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT, &m_indices[0]);
+	++m_drawCalls;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "texture.h"
+#include "shaderprogram.h"
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * Sprites are submitted in whatever order is convenient and drawn in
+ * sort key order on flush():
+ *
+ *	| layer (16) | program (16) | texture (32) |
+ *
+ * So everything on a lower layer is drawn first and within a layer
+ * all sprites that share a texture end up in the same draw call.
+ */
+class RenderQueue
+{
+public:
+	RenderQueue(GLint vertexLocation, GLint texCoordLocation, GLint orientationLocation);
+	virtual ~RenderQueue() { }
+
+	static uint64_t makeKey(unsigned layer, GLuint program, GLuint texture)
+	{
+		return (uint64_t)(layer & 0xFFFF) << 48
+			| (uint64_t)(program & 0xFFFF) << 32
+			| texture;
+	}
+
+	void submit(unsigned layer, ShaderProgram *program, const TexturePtr& texture, float x, float y,
+		    float size = 32, uint8_t orientation = 0);
+	void flush();
+
+	size_t lastDrawCalls() const { return m_drawCalls; }
+
+protected:
+	struct Command {
+		uint64_t key;
+		ShaderProgram *program;
+		Texture *texture;
+		GLfloat x, y;
+		GLfloat size;
+		GLfloat orientation;
+	};
+
+	void sort();
+	// Called in order for every batch of commands sharing program and texture.
+	virtual void draw(size_t begin, size_t end);
+
+	size_t m_drawCalls;
+	std::vector<Command> m_commands;
+
+private:
+	GLint m_vertexLocation;
+	GLint m_texCoordLocation;
+	GLint m_orientationLocation;
+
+	std::vector<Command> m_scratch;
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLfloat> m_texCoords;
+	std::vector<GLfloat> m_orientations;
+	std::vector<GLushort> m_indices;
+};
+
+#endif
+
@@ -25,36 +25,140 @@
 
 Scheduler g_sched;
 
+static SteadyClock steadyClock;
+
+StealDeque::Array::Array(int64_t capacity)
+	: capacity(capacity),
+	  slots(new std::atomic<Event *>[capacity])
+{
+}
+
+StealDeque::StealDeque()
+	: m_top(0),
+	  m_bottom(0)
+{
+	m_arrays.emplace_back(new Array(256));
+	m_array = m_arrays.back().get();
+}
+
+void StealDeque::push(Event *event)
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_top.load(std::memory_order_acquire);
+	Array *array = m_array.load(std::memory_order_relaxed);
+	if (bottom - top >= array->capacity) {
+		Array *bigger = new Array(array->capacity * 2);
+		for (int64_t i = top; i < bottom; ++i)
+			bigger->put(i, array->get(i));
+		m_arrays.emplace_back(bigger);
+		m_array.store(bigger, std::memory_order_release);
+		array = bigger;
+	}
+
+	array->put(bottom, event);
+	m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+Event *StealDeque::take()
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	Array *array = m_array.load(std::memory_order_relaxed);
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom) {
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Event *event = array->get(bottom);
+	if (top == bottom) {
+		// The last one, a thief may be after it too.
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			event = nullptr;
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return event;
+}
+
+Event *StealDeque::steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+	if (top >= bottom)
+		return nullptr;
+
+	Event *event = m_array.load(std::memory_order_acquire)->get(top);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+	return event;
+}
+
 Scheduler::Scheduler()
+	: m_ready(nullptr),
+	  m_firstEvent(nullptr),
+	  m_lastEvent(nullptr),
+	  m_nextWorker(0),
+	  m_queued(0),
+	  m_sleeping(0),
+	  m_workersStopped(false)
 {
-	m_thread = std::thread(std::bind(&Scheduler::schedulerThread, this));
 	m_stopped = false;
+	m_dispatching = false;
+	m_clock = &steadyClock;
+	m_thread = std::thread(std::bind(&Scheduler::schedulerThread, this));
 }
 
 Scheduler::~Scheduler()
 {
-
+	stop();
 }
 
 void Scheduler::stop()
 {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopped = true;
+		m_condition.notify_one();
+	}
+
+	// Let whatever is running finish, nothing gets called after this.
+	if (m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id())
+		m_thread.join();
+	stopWorkers();
+	discardReady();
+
 	std::lock_guard<std::mutex> guard(m_mutex);
-	m_stopped = true;
-	m_condition.notify_one();
+	while (m_firstEvent)
+		adopt(unlinkFirst());
 }
 
-EventPtr Scheduler::scheduleEvent(const EventFunc& fun, int64_t delay)
+EventPtr Scheduler::scheduleEvent(const EventFunc& fun, int64_t delay, uint64_t key)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 	if (m_stopped)
 		return nullptr;
 
-	EventPtr event(new Event(fun, delay));
-	m_eventList.push_back(event);
+	EventPtr event = std::make_shared<Event>(fun, m_clock->now() + std::chrono::milliseconds(delay), key);
+	event->m_self = event;
+	link(event.get());
 	m_condition.notify_one();
 	return event;
 }
 
+bool Scheduler::scheduleWait(Event& event)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_stopped)
+		return false;
+
+	link(&event);
+	m_condition.notify_one();
+	return true;
+}
+
 void Scheduler::removeEvent(const EventPtr& event)
 {
 	// avoid race conditions and just remove in the thread
@@ -62,39 +166,368 @@ void Scheduler::removeEvent(const EventPtr& event)
 	event->setGarbage(true);
 }
 
-void Scheduler::schedulerThread()
+bool SleepAwaiter::await_suspend(std::coroutine_handle<> coroutine)
 {
-	std::unique_lock<std::mutex> uniqueLock(m_mutex, std::defer_lock);
+	m_event.emplace(coroutine, m_scheduler.now() + std::chrono::milliseconds(m_ms), m_key);
+	if (m_scheduler.scheduleWait(*m_event))
+		return true;
 
-	while (!m_stopped) {	
-		uniqueLock.lock();
-		while (m_eventList.empty())
-			m_condition.wait(uniqueLock);
+	// Nothing would ever resume it, this goes with the frame.
+	coroutine.destroy();
+	return true;
+}
+
+Event *Scheduler::hold(EventPtr&& event)
+{
+	// Nobody owns what a coroutine waits with, its frame does.
+	Event *raw = event.get();
+	if (event.use_count())
+		raw->m_self = std::move(event);
+	return raw;
+}
+
+EventPtr Scheduler::adopt(Event *event)
+{
+	if (event->m_self)
+		return std::move(event->m_self);
+	return EventPtr(EventPtr(), event);
+}
 
-		if (m_stopped) {
-			uniqueLock.unlock();
+void Scheduler::link(Event *event)
+{
+	// Those due at the same time in the order they came, most often
+	// that's the end.
+	Event **next = &m_firstEvent;
+	if (m_lastEvent && m_lastEvent->waitTime() <= event->waitTime())
+		next = &m_lastEvent->m_next;
+	else
+		while (*next && (*next)->waitTime() <= event->waitTime())
+			next = &(*next)->m_next;
+
+	event->m_next = *next;
+	*next = event;
+	if (!event->m_next)
+		m_lastEvent = event;
+}
+
+Event *Scheduler::unlinkFirst()
+{
+	Event *event = m_firstEvent;
+	m_firstEvent = event->m_next;
+	if (!m_firstEvent)
+		m_lastEvent = nullptr;
+	return event;
+}
+
+Clock::Time Scheduler::nextWaitTime()
+{
+	// Removed ones further back go once they're due.
+	while (m_firstEvent && m_firstEvent->garbage())
+		adopt(unlinkFirst());
+	return m_firstEvent ? m_firstEvent->waitTime() : Clock::Time::max();
+}
+
+void Scheduler::takeExpired(Clock::Time before, std::vector<EventPtr>& expired)
+{
+	while (m_firstEvent && m_firstEvent->waitTime() < before)
+		expired.push_back(adopt(unlinkFirst()));
+}
+
+void Scheduler::setClock(Clock *clock)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_clock = clock ? clock : &steadyClock;
+	m_condition.notify_one();
+}
+
+void Scheduler::advance(int64_t ms)
+{
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+	ManualClock *clock = m_clock->manual() ? static_cast<ManualClock *>(m_clock) : nullptr;
+	if (!clock)
+		return;
+
+	const Clock::Time end = clock->now() + std::chrono::milliseconds(ms);
+	std::vector<EventPtr> due;
+	while (!m_stopped) {
+		const Clock::Time next = nextWaitTime();
+		if (next > end)
 			break;
-		}
+
+		// Whatever these schedule for right now comes next time round.
+		clock->set(std::max(next, clock->now()));
+		takeExpired(next + Clock::Time::duration(1), due);
 
 		uniqueLock.unlock();
-		for (auto it = m_eventList.begin(); it != m_eventList.end();) {
-			uniqueLock.lock();
-			const EventPtr& ev = *it;
-			uniqueLock.unlock();
-
-			if (ev->garbage()) {
-				uniqueLock.lock();
-				it = m_eventList.erase(it);
-				uniqueLock.unlock();
-			} else if (ev->expired()) {
-				(*ev) ();
-
-				uniqueLock.lock();
-				it = m_eventList.erase(it);
-				uniqueLock.unlock();
-			} else
-				++it;
+		for (const EventPtr& event : due)
+			if (!event->garbage())
+				(*event) ();
+		due.clear();
+		uniqueLock.lock();
+	}
+	clock->set(end);
+}
+
+void Scheduler::setWorkers(unsigned count)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_stopped || !m_workers.empty())
+		return;
+
+	for (unsigned i = 0; i < count; ++i)
+		m_workers.emplace_back(new Worker);
+	m_batches.resize(count, nullptr);
+	for (unsigned i = 0; i < count; ++i)
+		m_workers[i]->thread = std::thread(&Scheduler::workerThread, this, i);
+}
+
+void Scheduler::stopWorkers()
+{
+	m_workersStopped = true;
+	for (const std::unique_ptr<Worker>& worker : m_workers) {
+		std::lock_guard<std::mutex> guard(worker->mutex);
+		worker->wake.notify_one();
+	}
+
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+		if (worker->thread.joinable() && worker->thread.get_id() != std::this_thread::get_id())
+			worker->thread.join();
+
+	// Let go of what they didn't get to.
+	for (const std::unique_ptr<Worker>& worker : m_workers) {
+		unpack(*worker, *worker);
+		while (Event *event = worker->events.take())
+			adopt(event);
+	}
+}
+
+void Scheduler::enqueue(std::vector<EventPtr>& events)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_strandMutex);
+		for (EventPtr& event : events) {
+			// One with the same key is running, its worker takes this
+			// one next.
+			if (event->key()) {
+				auto it = m_strands.find(event->key());
+				if (it != m_strands.end()) {
+					it->second.push_back(std::move(event));
+					continue;
+				}
+				m_strands[event->key()];
+			}
+
+			Batch *&batch = m_batches[m_nextWorker++ % m_workers.size()];
+			if (!batch)
+				batch = new Batch;
+			batch->events.push_back(std::move(event));
+		}
+	}
+
+	for (size_t i = 0; i < m_workers.size(); ++i) {
+		Batch *batch = m_batches[i];
+		if (!batch)
+			continue;
+		m_batches[i] = nullptr;
+
+		const long count = batch->events.size();
+		Worker& worker = *m_workers[i];
+		batch->next = worker.inbox.load(std::memory_order_relaxed);
+		while (!worker.inbox.compare_exchange_weak(batch->next, batch,
+							   std::memory_order_release, std::memory_order_relaxed))
+			;
+
+		// Only touch the others when one of them is idle.
+		m_queued += count;
+		if (m_sleeping > 0)
+			wakeWorker(i);
+	}
+}
+
+void Scheduler::wakeWorker(size_t index)
+{
+	// The one it went to if that's asleep, otherwise any that is.
+	for (size_t i = 0; i < m_workers.size(); ++i) {
+		Worker& worker = *m_workers[(index + i) % m_workers.size()];
+		std::lock_guard<std::mutex> guard(worker.mutex);
+		if (worker.sleeping) {
+			worker.wake.notify_one();
+			return;
 		}
 	}
 }
 
+bool Scheduler::unpack(Worker& to, Worker& from)
+{
+	Batch *batch = from.inbox.exchange(nullptr, std::memory_order_acquire);
+	if (!batch)
+		return false;
+
+	while (batch) {
+		for (EventPtr& event : batch->events)
+			to.events.push(hold(std::move(event)));
+
+		Batch *next = batch->next;
+		delete batch;
+		batch = next;
+	}
+	return true;
+}
+
+EventPtr Scheduler::takeEvent(size_t index)
+{
+	if (m_queued <= 0)
+		return nullptr;
+
+	// Its own first, then the others' oldest, then the batches they
+	// haven't got round to.
+	Worker& self = *m_workers[index];
+	Event *event = self.events.take();
+	if (!event && unpack(self, self))
+		event = self.events.take();
+	for (size_t i = 1; i < m_workers.size() && !event; ++i)
+		event = m_workers[(index + i) % m_workers.size()]->events.steal();
+	for (size_t i = 1; i < m_workers.size() && !event; ++i)
+		if (unpack(self, *m_workers[(index + i) % m_workers.size()]))
+			event = self.events.take();
+
+	if (!event)
+		return nullptr;
+	--m_queued;
+	return adopt(event);
+}
+
+EventPtr Scheduler::nextInStrand(uint64_t key)
+{
+	if (!key)
+		return nullptr;
+
+	std::lock_guard<std::mutex> guard(m_strandMutex);
+	auto it = m_strands.find(key);
+	if (it->second.empty()) {
+		m_strands.erase(it);
+		return nullptr;
+	}
+
+	EventPtr event = it->second.front();
+	it->second.pop_front();
+	return event;
+}
+
+void Scheduler::workerThread(size_t index)
+{
+	Worker& self = *m_workers[index];
+	while (!m_workersStopped) {
+		EventPtr event = takeEvent(index);
+		if (!event) {
+			// Counted as sleeping before looking at m_queued, so that
+			// enqueue() either sees it asleep or it sees the event.
+			std::unique_lock<std::mutex> lock(self.mutex);
+			self.sleeping = true;
+			++m_sleeping;
+			while (m_queued <= 0 && !m_workersStopped)
+				self.wake.wait(lock);
+			self.sleeping = false;
+			--m_sleeping;
+			continue;
+		}
+
+		while (event) {
+			// A coroutine's event is gone once it has run.
+			const uint64_t key = event->key();
+			if (!event->garbage())
+				(*event) ();
+			event = nextInStrand(key);
+		}
+	}
+}
+
+void Scheduler::setDispatching(bool dispatching)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_dispatching = dispatching;
+}
+
+void Scheduler::dispatch()
+{
+	Batch *batch = m_ready.exchange(nullptr, std::memory_order_acquire);
+
+	// Oldest first.
+	Batch *oldest = nullptr;
+	while (batch) {
+		Batch *next = batch->next;
+		batch->next = oldest;
+		oldest = batch;
+		batch = next;
+	}
+
+	while (oldest) {
+		for (const EventPtr& event : oldest->events)
+			if (!event->garbage())
+				(*event) ();
+
+		Batch *next = oldest->next;
+		delete oldest;
+		oldest = next;
+	}
+}
+
+void Scheduler::discardReady()
+{
+	Batch *batch = m_ready.exchange(nullptr, std::memory_order_acquire);
+	while (batch) {
+		Batch *next = batch->next;
+		delete batch;
+		batch = next;
+	}
+}
+
+void Scheduler::schedulerThread()
+{
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+	std::vector<EventPtr> expired;
+
+	while (!m_stopped) {
+		while ((!m_firstEvent || m_clock->manual()) && !m_stopped)
+			m_condition.wait(uniqueLock);
+		if (m_stopped)
+			break;
+
+		// Sleep until the end of the millisecond the first event is due
+		// in, so everything due in the same one goes in one wakeup.
+		auto due = nextWaitTime();
+		if (!m_firstEvent)
+			continue;
+
+		due = std::chrono::time_point_cast<std::chrono::milliseconds>(due) + std::chrono::milliseconds(1);
+		if (m_clock->now() < due) {
+			// Woken early when something new comes in, it might be due
+			// sooner.
+			m_condition.wait_until(uniqueLock, due);
+			continue;
+		}
+
+		takeExpired(due, expired);
+
+		if (m_dispatching) {
+			Batch *batch = new Batch;
+			batch->events.swap(expired);
+			batch->next = m_ready.load(std::memory_order_relaxed);
+			while (!m_ready.compare_exchange_weak(batch->next, batch,
+							      std::memory_order_release, std::memory_order_relaxed))
+				;
+			continue;
+		}
+
+		// The events may schedule more.
+		uniqueLock.unlock();
+		if (!m_workers.empty())
+			enqueue(expired);
+		else
+			for (const EventPtr& event : expired)
+				if (!event->garbage())
+					(*event) ();
+		expired.clear();
+		uniqueLock.lock();
+	}
+}
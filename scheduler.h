@@ -26,51 +26,266 @@
 #include <functional>
 #include <memory>
 #include <condition_variable>
-#include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
 #include <chrono>
+#include <coroutine>
+#include <optional>
 
 typedef std::function<void ()> EventFunc;
 
+/*
+ * Where the scheduler gets the time from.  SteadyClock is the real one, a
+ * ManualClock only moves when Scheduler::advance() moves it.
+ */
+class Clock
+{
+public:
+	typedef std::chrono::steady_clock::time_point Time;
+
+	virtual ~Clock() { }
+	virtual Time now() const = 0;
+	// Nobody waits for it to move by itself.
+	virtual bool manual() const { return false; }
+};
+
+class SteadyClock : public Clock
+{
+public:
+	Time now() const { return std::chrono::steady_clock::now(); }
+};
+
+class ManualClock : public Clock
+{
+public:
+	ManualClock() : m_ticks(0) { }
+
+	Time now() const { return Time(Time::duration(m_ticks)); }
+	bool manual() const { return true; }
+	void set(Time time) { m_ticks = time.time_since_epoch().count(); }
+
+private:
+	std::atomic<Time::duration::rep> m_ticks;
+};
+
 struct Event
 {
-	Event(const EventFunc& f, int64_t delay)
+	Event(const EventFunc& f, Clock::Time waitTime, uint64_t key)
 	{
 		m_garbage = false;
 		m_f = f;
-		m_waitTime = std::chrono::system_clock::now() + std::chrono::milliseconds(delay);
+		m_waitTime = waitTime;
+		m_key = key;
+		m_next = nullptr;
+	}
+	// Resumes @coroutine, whose frame it is part of.
+	Event(std::coroutine_handle<> coroutine, Clock::Time waitTime, uint64_t key)
+	{
+		m_garbage = false;
+		m_coroutine = coroutine;
+		m_waitTime = waitTime;
+		m_key = key;
+		m_next = nullptr;
 	}
-	bool expired() const { return std::chrono::system_clock::now() >= m_waitTime; } 
+	Clock::Time waitTime() const { return m_waitTime; }
+	uint64_t key() const { return m_key; }
 	bool garbage() const { return m_garbage; }
 	void setGarbage(bool g) { m_garbage = g; }
-	void operator()() { m_f(); }
+	void operator()()
+	{
+		if (!m_coroutine) {
+			m_f();
+			return;
+		}
+
+		// Gone with the frame once it carries on.
+		std::coroutine_handle<> coroutine = m_coroutine;
+		coroutine.resume();
+	}
 
 private:
-	bool m_garbage;
+	friend class Scheduler;
+
+	std::atomic<bool> m_garbage;
 	EventFunc m_f;
-	std::chrono::time_point<std::chrono::system_clock> m_waitTime;
+	std::coroutine_handle<> m_coroutine;
+	Clock::Time m_waitTime;
+	uint64_t m_key;
+	// The scheduler's waiting list runs through the events.  The ones
+	// scheduleEvent() made hold on to themselves while they're on it or
+	// in a worker's queue.
+	Event *m_next;
+	std::shared_ptr<Event> m_self;
 };
 typedef std::shared_ptr<Event> EventPtr;
 
+class Scheduler;
+
+/*
+ * A worker's queue (Chase and Lev's): only the worker it belongs to pushes
+ * and takes, at the bottom, the others steal from the top with no more
+ * than a compare and swap.
+ */
+class StealDeque
+{
+public:
+	StealDeque();
+
+	void push(Event *event);
+	Event *take();
+	// Null when it is empty or another thief got there first.
+	Event *steal();
+
+private:
+	struct Array {
+		explicit Array(int64_t capacity);
+		Event *get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+		void put(int64_t i, Event *event) { slots[i & (capacity - 1)].store(event, std::memory_order_relaxed); }
+
+		const int64_t capacity;
+		std::unique_ptr<std::atomic<Event *>[]> slots;
+	};
+
+	std::atomic<int64_t> m_top;
+	std::atomic<int64_t> m_bottom;
+	std::atomic<Array *> m_array;
+	// Every one it ever had, a thief may still be reading an old one.
+	std::vector<std::unique_ptr<Array>> m_arrays;
+};
+
+// What Scheduler::sleep() gives to co_await.
+class SleepAwaiter
+{
+public:
+	SleepAwaiter(Scheduler& scheduler, int64_t ms, uint64_t key)
+		: m_scheduler(scheduler), m_ms(ms), m_key(key)
+	{ }
+
+	bool await_ready() const { return false; }
+	bool await_suspend(std::coroutine_handle<> coroutine);
+	void await_resume() { }
+
+private:
+	Scheduler& m_scheduler;
+	int64_t m_ms;
+	uint64_t m_key;
+	// In the coroutine's frame for as long as it sleeps, so sleeping
+	// doesn't allocate.
+	std::optional<Event> m_event;
+};
+
 class Scheduler
 {
 public:
 	Scheduler();
 	~Scheduler();
 
-	EventPtr scheduleEvent(const EventFunc& fun, int64_t delay);
+	// Events with the same non-zero @key never run at the same time, in
+	// the order they expire.
+	EventPtr scheduleEvent(const EventFunc& fun, int64_t delay, uint64_t key = 0);
 	void removeEvent(const EventPtr& event);
 	void stop();
+	// co_await it in a Script to carry on @ms later, from wherever
+	// scheduled events run.
+	SleepAwaiter sleep(int64_t ms, uint64_t key = 0) { return SleepAwaiter(*this, ms, key); }
+
+	// Before anything is scheduled, null for the steady clock.  With a
+	// manual one nothing runs but what advance() runs.
+	void setClock(Clock *clock);
+	Clock::Time now() const { return m_clock->now(); }
+	// Moves the manual clock @ms on, running every event that comes due
+	// on the way on this thread, at the time it was due.  Workers are left
+	// out, one after the other keeps keyed events apart anyway.
+	void advance(int64_t ms);
+
+	// Runs expired events on @count threads of their own instead of the
+	// scheduler thread, before anything is scheduled.  Each gets a batch
+	// of every wakeup's events and steals from the others when it runs
+	// dry.
+	void setWorkers(unsigned count);
+
+	// Instead of calling them itself, the scheduler thread hands expired
+	// events over to dispatch(), so they run on whichever thread calls it.
+	void setDispatching(bool dispatching);
+	// Runs what expired since the last call, oldest first.
+	void dispatch();
 
 protected:
 	void schedulerThread();
+	void workerThread(size_t index);
+
+	friend class SleepAwaiter;
+	// Puts @event, owned by whoever waits, on the waiting list.  False
+	// once stopped.
+	bool scheduleWait(Event& event);
 
 private:
+	// Events that expired within the same millisecond, handed over as one.
+	struct Batch {
+		std::vector<EventPtr> events;
+		Batch *next;
+	};
+
+	struct Worker {
+		// Batches from the scheduler thread it hasn't unpacked yet,
+		// newest first.
+		std::atomic<Batch *> inbox = nullptr;
+		StealDeque events;
+		// Set under mutex while it waits on wake for something to do.
+		std::mutex mutex;
+		bool sleeping = false;
+		std::condition_variable wake;
+		std::thread thread;
+	};
+
+	// A queued event holds on to itself, see Event::m_self.
+	static Event *hold(EventPtr&& event);
+	static EventPtr adopt(Event *event);
+
+	void link(Event *event);
+	Event *unlinkFirst();
+	// Drops removed events, returns when the first one left is due.
+	Clock::Time nextWaitTime();
+	void takeExpired(Clock::Time before, std::vector<EventPtr>& expired);
+
+	void discardReady();
+	void enqueue(std::vector<EventPtr>& events);
+	void wakeWorker(size_t index);
+	// Moves the batches in @from's inbox over to @to's queue.
+	bool unpack(Worker& to, Worker& from);
+	EventPtr takeEvent(size_t index);
+	EventPtr nextInStrand(uint64_t key);
+	void stopWorkers();
+
 	bool m_stopped;
+	bool m_dispatching;
+	Clock *m_clock;
+	// Pushed by the scheduler thread and taken all at once by dispatch(),
+	// newest first.
+	std::atomic<Batch *> m_ready;
 
-	std::list<EventPtr> m_eventList;
+	// In the order they're due, linked through Event::m_next.
+	Event *m_firstEvent;
+	Event *m_lastEvent;
 	std::thread m_thread;
 	std::mutex m_mutex;
 	std::condition_variable m_condition;
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	size_t m_nextWorker;
+	// What enqueue() is filling for each worker.
+	std::vector<Batch *> m_batches;
+	// Events in the workers' queues, it can dip below 0 when one is
+	// taken before it is counted.
+	std::atomic<long> m_queued;
+	std::atomic<unsigned> m_sleeping;
+	std::atomic<bool> m_workersStopped;
+	// Events waiting for the one with their key to finish, a key is in
+	// here for as long as one of its events runs.
+	std::unordered_map<uint64_t, std::deque<EventPtr>> m_strands;
+	std::mutex m_strandMutex;
 };
 
 extern Scheduler g_sched;
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "script.h"
+
+#include <mutex>
+#include <new>
+
+static const size_t sizeClass = 64;
+static const size_t sizeClasses = 16;
+
+// A free frame, the memory itself holds the list.
+struct FreeFrame {
+	FreeFrame *next;
+};
+
+static std::mutex poolMutex;
+static FreeFrame *freeFrames[sizeClasses];
+
+void *ScriptPool::allocate(size_t size)
+{
+	const size_t index = (size - 1) / sizeClass;
+	if (index >= sizeClasses)
+		return ::operator new(size);
+
+	{
+		std::lock_guard<std::mutex> guard(poolMutex);
+		FreeFrame *frame = freeFrames[index];
+		if (frame) {
+			freeFrames[index] = frame->next;
+			return frame;
+		}
+	}
+	return ::operator new((index + 1) * sizeClass);
+}
+
+void ScriptPool::release(void *frame, size_t size)
+{
+	const size_t index = (size - 1) / sizeClass;
+	if (index >= sizeClasses) {
+		::operator delete(frame);
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(poolMutex);
+	FreeFrame *free = static_cast<FreeFrame *>(frame);
+	free->next = freeFrames[index];
+	freeFrames[index] = free;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <coroutine>
+#include <exception>
+#include <cstddef>
+
+/*
+ * Keeps the frames of finished scripts for the next ones, in size classes
+ * of 64 bytes, so starting a script doesn't go to the heap once as many
+ * have run at the same time as ever will.
+ */
+class ScriptPool
+{
+public:
+	static void *allocate(size_t size);
+	static void release(void *frame, size_t size);
+};
+
+/*
+ * A timed piece of game logic written straight down, a coroutine that
+ * co_awaits Scheduler::sleep() wherever it has to wait:
+ *
+ *	Script Game::foodLifetime(...)
+ *	{
+ *		co_await g_sched.sleep(2000);
+ *		...
+ *	}
+ *
+ * It starts right away when called and frees itself when done, whoever
+ * called it doesn't keep anything.  One still asleep when the scheduler
+ * stops is never resumed, one going to sleep after that is destroyed.
+ */
+class Script
+{
+public:
+	struct promise_type {
+		Script get_return_object() { return Script(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() { }
+		void unhandled_exception() { std::terminate(); }
+
+		static void *operator new(size_t size) { return ScriptPool::allocate(size); }
+		static void operator delete(void *frame, size_t size) { ScriptPool::release(frame, size); }
+	};
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "server.h"
+#include "scheduler.h"
+
+#include <poll.h>
+#include <unistd.h>
+#include <iostream>
+
+Server::Server()
+	: m_world(m_map),
+	  m_listenFd(-1),
+	  m_spectatorFd(-1),
+	  m_interval(0),
+	  m_tick(0),
+	  m_lastTickSize(0)
+{
+}
+
+Server::~Server()
+{
+	if (m_listenFd >= 0)
+		close(m_listenFd);
+	if (m_spectatorFd >= 0)
+		close(m_spectatorFd);
+}
+
+bool Server::start(int port, int cols, int rows, int aiSnakes)
+{
+	m_listenFd = listenTcp(port);
+	if (m_listenFd < 0)
+		return false;
+
+	m_map.resize(cols, rows, SPRITE_GRASS);
+	m_world.spawn(aiSnakes);
+	// Whatever was there before the first tick goes out with the snapshot.
+	m_map.trackChanges(true);
+	return true;
+}
+
+bool Server::listenSpectators(int port)
+{
+	m_spectatorFd = listenTcp(port);
+	return m_spectatorFd >= 0;
+}
+
+size_t Server::clientCount() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_clients.size();
+}
+
+void Server::join(int fd, bool spectator)
+{
+	Client client;
+	client.connection.reset(new Connection(fd));
+	client.snake = NO_SNAKE;
+	client.dead = false;
+	if (!spectator) {
+		// The world is full, the connection closes with the client.
+		Point pos;
+		if (!m_world.randomFreePos(pos)) {
+			std::cerr << "No room for another snake, turning a player away" << std::endl;
+			return;
+		}
+		client.snake = m_world.addSnake(pos, DIRECTION_EAST, CONTROL_REMOTE);
+	}
+
+	// Changes since the last tick are in the snapshot already, getting
+	// them again with the next tick does no harm.
+	std::vector<CellChange> cells;
+	std::vector<uint8_t> message;
+	m_map.snapshot(cells);
+	writeWelcome(message, m_map, client.snake);
+	std::vector<SnakeHead> heads = m_heads;
+	if (!spectator)
+		heads.push_back(SnakeHead { client.snake, GridPoint::fromPixels(m_world.snake(client.snake).pos()) });
+	writeState(message, MSG_SNAPSHOT, m_tick, heads, cells);
+	if (!client.connection->send(message)) {
+		if (!spectator)
+			m_world.removeSnake(client.snake);
+		return;
+	}
+
+	m_clients.push_back(std::move(client));
+}
+
+void Server::handleMessage(Client& client, const uint8_t *data, size_t size)
+{
+	MessageReader in(data, size);
+	switch (in.u8()) {
+	case MSG_INPUT: {
+		const uint8_t dir = in.u8();
+		if (in.ok() && dir < DIRECTION_INVALID && client.snake != NO_SNAKE)
+			m_world.steer(client.snake, static_cast<Direction_t>(dir));
+		break;
+	}
+	default:
+		// Players don't send anything else, spectators are ignored.
+		if (client.snake != NO_SNAKE)
+			client.dead = true;
+		break;
+	}
+}
+
+void Server::poll(int timeout)
+{
+	std::vector<pollfd> fds;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		fds.push_back(pollfd { m_listenFd, POLLIN, 0 });
+		fds.push_back(pollfd { m_spectatorFd, POLLIN, 0 });	// Skipped if -1.
+		for (const Client& client : m_clients) {
+			short events = POLLIN;
+			if (client.connection->wantsWrite())
+				events |= POLLOUT;
+			fds.push_back(pollfd { client.connection->fd(), events, 0 });
+		}
+	}
+
+	if (::poll(fds.data(), fds.size(), timeout) <= 0)
+		return;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// Only this drops clients, so they are still where they were.
+	for (size_t i = 2; i < fds.size(); ++i) {
+		Client& client = m_clients[i - 2];
+		if (fds[i].revents & (POLLERR | POLLHUP))
+			client.dead = true;
+		if (!client.dead && (fds[i].revents & POLLOUT) && !client.connection->flush())
+			client.dead = true;
+		if (!client.dead && (fds[i].revents & POLLIN)) {
+			if (!client.connection->receive())
+				client.dead = true;
+
+			const uint8_t *data;
+			size_t size;
+			while (!client.dead && client.connection->nextMessage(data, size))
+				handleMessage(client, data, size);
+			if (client.connection->broken())
+				client.dead = true;
+		}
+	}
+
+	for (auto it = m_clients.begin(); it != m_clients.end();) {
+		if (it->dead) {
+			if (it->snake != NO_SNAKE)
+				m_world.removeSnake(it->snake);
+			it = m_clients.erase(it);
+		} else
+			++it;
+	}
+
+	int fd;
+	if (fds[0].revents & POLLIN)
+		while ((fd = acceptTcp(m_listenFd)) >= 0)
+			join(fd, false);
+	if (fds[1].revents & POLLIN)
+		while ((fd = acceptTcp(m_spectatorFd)) >= 0)
+			join(fd, true);
+}
+
+void Server::tick()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_world.step();
+	++m_tick;
+
+	m_heads.clear();
+	for (const Client& client : m_clients)
+		if (client.snake != NO_SNAKE)
+			m_heads.push_back(SnakeHead { client.snake, GridPoint::fromPixels(m_world.snake(client.snake).pos()) });
+
+	// Encoded once, every connection queues the very same buffer.
+	std::shared_ptr<std::vector<uint8_t>> message = std::make_shared<std::vector<uint8_t>>();
+	m_map.takeChanges(m_changes);
+	writeState(*message, MSG_TICK, m_tick, m_heads, m_changes);
+	m_lastTickSize = message->size();
+
+	const SharedBuffer shared = std::move(message);
+	for (Client& client : m_clients)
+		if (!client.dead && !client.connection->send(shared))
+			client.dead = true;
+}
+
+void Server::run(int interval)
+{
+	m_interval = interval;
+	scheduleTick();
+}
+
+void Server::scheduleTick()
+{
+	// Keyed by the server, so with workers its ticks still go one at a time.
+	g_sched.scheduleEvent([this] () {
+		tick();
+		scheduleTick();
+	}, m_interval, reinterpret_cast<uintptr_t>(this));
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "world.h"
+#include "protocol.h"
+#include "net.h"
+
+#include <memory>
+#include <mutex>
+
+/*
+ * Runs the game for everyone connected.  Players join with a snake of
+ * their own, steer it with MSG_INPUT and get sent what changed after
+ * every tick.  Spectators connect to a port of their own, get the same
+ * and can't do anything.  poll() does the network and tick() the game,
+ * they may be called from different threads.
+ */
+class Server
+{
+public:
+	Server();
+	~Server();
+
+	// @aiSnakes share the world with the players.
+	bool start(int port, int cols, int rows, int aiSnakes);
+	int port() const { return boundPort(m_listenFd); }
+	bool listenSpectators(int port);
+	int spectatorPort() const { return boundPort(m_spectatorFd); }
+
+	// Accepts new players, reads their input and sends what they didn't
+	// take yet, waiting up to @timeout ms for any of it.
+	void poll(int timeout);
+	void tick();
+	// Tick every @interval ms from the scheduler.
+	void run(int interval);
+
+	// Players and spectators.
+	size_t clientCount() const;
+	uint32_t ticks() const { return m_tick; }
+	// Bytes of the last tick message, sent to each client.
+	size_t lastTickSize() const { return m_lastTickSize; }
+	const Map& map() const { return m_map; }
+
+private:
+	struct Client {
+		std::unique_ptr<Connection> connection;
+		SnakeId snake;		// NO_SNAKE for spectators.
+		bool dead;
+	};
+
+	void join(int fd, bool spectator);
+	void handleMessage(Client& client, const uint8_t *data, size_t size);
+	void scheduleTick();
+
+	mutable std::mutex m_mutex;
+	Map m_map;
+	World m_world;
+	int m_listenFd;
+	int m_spectatorFd;
+	int m_interval;
+	uint32_t m_tick;
+	size_t m_lastTickSize;
+
+	std::vector<Client> m_clients;
+	std::vector<CellChange> m_changes;
+	std::vector<SnakeHead> m_heads;
+};
+
+#endif
+
@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "server.h"
+#include "scheduler.h"
+
+#include <sys/resource.h>
+#include <poll.h>
+#include <csignal>
+#include <ctime>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <iostream>
+#include <string>
+
+static volatile std::sig_atomic_t g_quit = 0;
+
+static double threadCpuSeconds()
+{
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct BenchClients
+{
+	std::atomic<bool> done;
+	// Set once the server is done ticking, lastTick first.
+	std::atomic<bool> stop;
+	std::atomic<bool> abort;
+	std::atomic<uint32_t> lastTick;
+	bool failed;
+	uint64_t bytes;
+	uint64_t messages;
+	// What the first client thinks the map looks like.
+	Map mirror;
+};
+
+/*
+ * Plays @count clients over loopback: reads and decodes everything the
+ * server sends, steers now and then unless spectating and keeps the first
+ * one's copy of the map up to date so that it can be checked against the
+ * server's at the end.
+ */
+static void runClients(int port, int count, bool spectate, BenchClients *bench)
+{
+	std::vector<std::unique_ptr<Connection>> clients;
+	std::vector<pollfd> fds;
+	for (int i = 0; i < count; ++i) {
+		clients.emplace_back(new Connection);
+		if (!clients.back()->connect("127.0.0.1", port)) {
+			bench->failed = true;
+			bench->done = true;
+			return;
+		}
+		fds.push_back(pollfd { clients.back()->fd(), POLLIN, 0 });
+	}
+
+	std::vector<SnakeHead> heads;
+	std::vector<CellChange> cells;
+	std::vector<uint8_t> input;
+	uint32_t seed = 2463534242u;
+	uint32_t firstTick = ~0u;
+
+	while (!bench->abort && !(bench->stop && firstTick == bench->lastTick)) {
+		if (::poll(fds.data(), fds.size(), 10) <= 0)
+			continue;
+
+		for (size_t i = 0; i < clients.size(); ++i) {
+			if (!(fds[i].revents & POLLIN))
+				continue;
+			if (!clients[i]->receive()) {
+				bench->failed = true;
+				bench->done = true;
+				return;
+			}
+
+			const uint8_t *data;
+			size_t size;
+			while (clients[i]->nextMessage(data, size)) {
+				bench->bytes += size + 4;
+				++bench->messages;
+
+				MessageReader in(data, size);
+				if (in.u8() == MSG_WELCOME) {
+					in.u16();
+					const int cols = in.u16();
+					const int rows = in.u16();
+					const SpriteId ground = in.u16();
+					if (i == 0)
+						bench->mirror.resize(cols, rows, ground);
+					continue;
+				}
+
+				uint32_t tick;
+				if (!readState(in, tick, heads, cells))
+					bench->failed = true;
+				if (i == 0) {
+					for (const CellChange& cell : cells)
+						bench->mirror.setSprite(cell.pos, static_cast<TileLayer>(cell.layer), cell.sprite);
+					firstTick = tick;
+				}
+
+				// Steer about every 8th tick.
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				if (!spectate && !(seed & 7)) {
+					input.clear();
+					writeInput(input, static_cast<Direction_t>(seed % DIRECTION_INVALID));
+					clients[i]->send(input);
+				}
+			}
+		}
+	}
+	bench->done = true;
+}
+
+static bool sameCells(const std::vector<CellChange>& cellsA, const Map& b)
+{
+	std::vector<CellChange> cellsB;
+	b.snapshot(cellsB);
+	if (cellsA.size() != cellsB.size())
+		return false;
+
+	for (size_t i = 0; i < cellsA.size(); ++i)
+		if (cellsA[i].key() != cellsB[i].key() || cellsA[i].sprite != cellsB[i].sprite)
+			return false;
+	return true;
+}
+
+static int bench(int clients, bool spectate, int seconds, int cols, int rows, int aiSnakes)
+{
+	// Both ends of every connection live in this process.
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	Server server;
+	if (!server.start(0, cols, rows, aiSnakes) || !server.listenSpectators(0))
+		return 1;
+
+	BenchClients bench;
+	bench.done = false;
+	bench.stop = false;
+	bench.abort = false;
+	bench.lastTick = 0;
+	bench.failed = false;
+	bench.bytes = bench.messages = 0;
+	std::thread clientThread(runClients, spectate ? server.spectatorPort() : server.port(),
+				 clients, spectate, &bench);
+
+	while (server.clientCount() < (size_t)clients && !bench.done)
+		server.poll(10);
+
+	// Tick as fast as it goes, the server's own CPU time tells how many
+	// ticks a second one core would manage.
+	const auto start = std::chrono::steady_clock::now();
+	const double startCpu = threadCpuSeconds();
+	const uint32_t startTick = server.ticks();
+	uint64_t tickBytes = 0;
+	while (!bench.done && std::chrono::steady_clock::now() - start < std::chrono::seconds(seconds)) {
+		server.poll(0);
+		server.tick();
+		tickBytes += server.lastTickSize();
+	}
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double cpu = threadCpuSeconds() - startCpu;
+	const uint32_t ticks = server.ticks() - startTick;
+	// Input still coming in changes the map before the clients see it.
+	std::vector<CellChange> expected;
+	server.map().snapshot(expected);
+
+	// Let the clients catch up on what is still queued.
+	bench.lastTick = server.ticks();
+	bench.stop = true;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (!bench.done && std::chrono::steady_clock::now() < deadline)
+		server.poll(10);
+	if (!bench.done) {
+		bench.failed = true;
+		bench.abort = true;
+	}
+	clientThread.join();
+
+	const bool inSync = sameCells(expected, bench.mirror);
+	std::cout << (spectate ? "Spectators:        " : "Clients:           ") << clients << std::endl;
+	std::cout << "AI snakes:         " << aiSnakes << " on " << cols << "x" << rows << std::endl;
+	std::cout << "Ticks:             " << ticks << " in " << wall << " s, " << ticks / wall << " per second" << std::endl;
+	if (ticks) {
+		std::cout << "Server CPU a tick: " << cpu / ticks * 1e6 << " us, "
+			  << ticks / cpu << " ticks/s on one core" << std::endl;
+		std::cout << "Tick message:      " << tickBytes / ticks << " bytes, "
+			  << tickBytes / ticks * clients << " bytes sent a tick" << std::endl;
+		std::cout << "Fan-out:           " << (double)ticks * clients / wall << " sends/s, "
+			  << tickBytes * clients / wall / (1 << 20) << " MB/s" << std::endl;
+	}
+	std::cout << "Received:          " << bench.messages << " messages, " << bench.bytes << " bytes" << std::endl;
+	std::cout << "Client map:        " << (inSync ? "matches the server" : "DIFFERS from the server") << std::endl;
+	return inSync && !bench.failed ? 0 : 1;
+}
+
+struct BenchGame
+{
+	BenchGame() : world(map), steps(0), running(false) { }
+
+	Map map;
+	World world;
+	std::atomic<uint32_t> steps;
+	std::atomic<bool> running;
+};
+
+/*
+ * Steps @games worlds of @aiSnakes each from the scheduler, as fast as its
+ * workers go.  Every world's steps share a key so they have to run one at
+ * a time, which is checked.
+ */
+static int benchScheduler(int games, int seconds, int cols, int rows, int aiSnakes)
+{
+	std::vector<std::unique_ptr<BenchGame>> worlds;
+	std::atomic<uint32_t> overlaps(0);
+	std::atomic<bool> stop(false);
+	std::function<void (BenchGame *)> step = [&] (BenchGame *game) {
+		if (game->running.exchange(true))
+			++overlaps;
+		game->world.step();
+		++game->steps;
+		game->running = false;
+		if (!stop)
+			g_sched.scheduleEvent(std::bind(step, game), 0, reinterpret_cast<uintptr_t>(game));
+	};
+
+	for (int i = 0; i < games; ++i) {
+		worlds.emplace_back(new BenchGame);
+		worlds.back()->map.resize(cols, rows, SPRITE_GRASS);
+		worlds.back()->world.spawn(aiSnakes);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (const std::unique_ptr<BenchGame>& game : worlds)
+		g_sched.scheduleEvent(std::bind(step, game.get()), 0, reinterpret_cast<uintptr_t>(game.get()));
+	std::this_thread::sleep_for(std::chrono::seconds(seconds));
+	stop = true;
+	g_sched.stop();
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t steps = 0;
+	for (const std::unique_ptr<BenchGame>& game : worlds)
+		steps += game->steps;
+	std::cout << "Worlds:            " << games << " of " << aiSnakes << " AI snakes on " << cols << "x" << rows << std::endl;
+	std::cout << "Steps:             " << steps << " in " << wall << " s, " << steps / wall << " per second" << std::endl;
+	std::cout << "Overlapping steps: " << overlaps << std::endl;
+	return overlaps ? 1 : 0;
+}
+
+static bool parseSize(const char *arg, int& cols, int& rows)
+{
+	return sscanf(arg, "%dx%d", &cols, &rows) == 2 && cols > 0 && rows > 0 && cols <= 32767 && rows <= 32767;
+}
+
+int main(int argc, char **argv)
+{
+	int port = DEFAULT_PORT;
+	int spectatorPort = DEFAULT_SPECTATOR_PORT;
+	int cols = 256, rows = 256;
+	int snakes = 0;
+	int interval = 190;
+	int benchClients = 0, benchSeconds = 0;
+	bool benchSpectators = false;
+	int benchWorlds = 0;
+	int workers = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--port" && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if (arg == "--spectator-port" && i + 1 < argc)
+			spectatorPort = atoi(argv[++i]);
+		else if (arg == "--world" && i + 1 < argc && parseSize(argv[i + 1], cols, rows))
+			++i;
+		else if (arg == "--snakes" && i + 1 < argc)
+			snakes = atoi(argv[++i]);
+		else if (arg == "--tick" && i + 1 < argc)
+			interval = atoi(argv[++i]);
+		else if (arg == "--workers" && i + 1 < argc)
+			workers = atoi(argv[++i]);
+		else if (arg == "--bench-scheduler" && i + 2 < argc) {
+			benchWorlds = atoi(argv[++i]);
+			benchSeconds = atoi(argv[++i]);
+		}
+		else if ((arg == "--bench" || arg == "--bench-spectators") && i + 2 < argc) {
+			benchSpectators = arg == "--bench-spectators";
+			benchClients = atoi(argv[++i]);
+			benchSeconds = atoi(argv[++i]);
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--port N] [--spectator-port N] [--world COLSxROWS]"
+				  << " [--snakes N] [--tick MS] [--workers N] [--bench CLIENTS SECONDS]"
+				  << " [--bench-spectators COUNT SECONDS] [--bench-scheduler WORLDS SECONDS]"
+				  << std::endl;
+			return 1;
+		}
+	}
+
+	srand(std::time(nullptr));
+	if (workers > 0)
+		g_sched.setWorkers(workers);
+	if (benchWorlds > 0)
+		return benchScheduler(benchWorlds, std::max(benchSeconds, 1), cols, rows, snakes);
+	if (benchClients > 0)
+		return bench(benchClients, benchSpectators, std::max(benchSeconds, 1), cols, rows, snakes);
+
+	Server server;
+	if (!server.start(port, cols, rows, snakes) || !server.listenSpectators(spectatorPort))
+		return 1;
+
+	signal(SIGINT, [] (int) { g_quit = 1; });
+	signal(SIGTERM, [] (int) { g_quit = 1; });
+	std::cout << "Listening on port " << server.port() << ", spectators on " << server.spectatorPort() << ", " << cols << "x" << rows
+		  << " tiles, a tick every " << interval << " ms" << std::endl;
+
+	server.run(interval);
+	while (!g_quit)
+		server.poll(100);
+
+	g_sched.stop();
+	return 0;
+}
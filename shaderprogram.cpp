@@ -20,10 +20,12 @@
  * THE SOFTWARE.
  */
 #include "shaderprogram.h"
+#include "glstate.h"
 
 #include <iostream>
 #include <string.h>
 #include <stdlib.h>
+#include <algorithm>
 
 static GLuint compileShader(const GLenum type, const char *src)
 {
@@ -52,6 +54,8 @@ static GLuint compileShader(const GLenum type, const char *src)
 }
 
 ShaderProgram::ShaderProgram()
+	: m_programId(0),
+	  m_projLocation(-1)
 {
 }
 
@@ -59,7 +63,10 @@ ShaderProgram::~ShaderProgram()
 {
 	for (unsigned i = 0; i < m_shaders.size(); ++i)
 		glDeleteShader(m_shaders[i]);
-	glDeleteProgram(m_programId);
+	if (m_programId) {
+		glDeleteProgram(m_programId);
+		g_glState.programDeleted(m_programId);
+	}
 }
 
 void ShaderProgram::create()
@@ -89,16 +96,24 @@ void ShaderProgram::bindAttribLocation(GLint location, const char *name)
 
 void ShaderProgram::setVertexData(GLint attribLoc, const GLvoid *values, GLint size)
 {
-	return glVertexAttribPointer(attribLoc, size, GL_FLOAT, GL_FALSE, 0, values);
+	g_glState.vertexAttribPointer(attribLoc, size, values);
+}
+
+GLint ShaderProgram::uniformLocation(const std::string& name) const
+{
+	auto it = m_uniforms.find(name);
+	if (it != m_uniforms.end())
+		return it->second;
+	return -1;
 }
 
 void ShaderProgram::setProjectionMatrix(const GLfloat *values)
 {
-	GLint loc = glGetUniformLocation(m_programId, "proj");
-	if (loc < 0)
+	if (m_projLocation < 0)
 		return;
 
-	return glUniformMatrix3fv(loc, 1, GL_FALSE, values);
+	g_glState.useProgram(m_programId);
+	return glUniformMatrix3fv(m_projLocation, 1, GL_FALSE, values);
 }
 
 bool ShaderProgram::link()
@@ -107,12 +122,30 @@ bool ShaderProgram::link()
 
 	int status = GL_FALSE;
 	glGetProgramiv(m_programId, GL_LINK_STATUS, &status);
-	return !!(status != GL_FALSE);
+	if (status == GL_FALSE)
+		return false;
+
+	// Look every uniform up once, they never move after linking.
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<GLchar> name(std::max(maxLength, 1));
+	m_uniforms.clear();
+	for (GLint i = 0; i < count; ++i) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(m_programId, i, name.size(), nullptr, &size, &type, &name[0]);
+		m_uniforms[&name[0]] = glGetUniformLocation(m_programId, &name[0]);
+	}
+
+	m_projLocation = uniformLocation("proj");
+	return true;
 }
 
 void ShaderProgram::bind()
 {
-	glUseProgram(m_programId);
+	g_glState.useProgram(m_programId);
 }
 
 std::string ShaderProgram::log()
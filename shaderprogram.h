@@ -24,12 +24,15 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 class ShaderProgram
 {
 private:
 	GLuint m_programId;
+	GLint m_projLocation;
 	std::vector<GLuint> m_shaders;
+	std::unordered_map<std::string, GLint> m_uniforms;
 
 public:
 	ShaderProgram();
@@ -39,8 +42,10 @@ public:
 	bool compile(const GLenum shaderType, const char *sourceCode);
 	bool link();
 	void bind();
+	GLuint id() const { return m_programId; }
 	std::string log();
 
+	GLint uniformLocation(const std::string& name) const;
 	void bindAttribLocation(GLint location, const char *name);
 	void setVertexData(GLint attribLocation, const GLvoid *values, GLint size);
 	void setProjectionMatrix(const GLfloat *values);
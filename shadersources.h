@@ -22,19 +22,32 @@
 #ifndef SHADERSOURCES_H
 #define SHADERSOURCES_H
 
-static const char *vertexSource =
+// Texture coordinates of a quad corner for spriteOrientation() @orientation.
+#define ORIENT_SOURCE \
+	"vec2 orient(vec2 corner, float orientation) {\n" \
+	"	float a = mod(orientation, 8.0) * -0.78539816;\n" \
+	"	vec2 d = corner - 0.5;\n" \
+	"	d = vec2(cos(a) * d.x - sin(a) * d.y, sin(a) * d.x + cos(a) * d.y);\n" \
+	"	if (orientation >= 8.0)\n" \
+	"		d.y = -d.y;\n" \
+	"	return d + 0.5;\n" \
+	"}\n"
+
+static const char *const vertexSource =
 	"uniform mat3 proj;\n"
 	"varying vec2 TexCoord;\n"
 	""
 	"attribute vec2 texcoord;\n"
 	"attribute vec2 vertex;\n"
+	"attribute float orientation;\n"
 	""
+	ORIENT_SOURCE
 	"void main() {\n"
 	"	gl_Position = vec4(proj * vec3(vertex.xy, 1), 1);\n"
-	"	TexCoord = texcoord;\n"
+	"	TexCoord = orient(texcoord, orientation);\n"
 	"}";
 
-static const char *fragmentSource =
+static const char *const fragmentSource =
 	"varying vec2 TexCoord;\n"
 	"uniform sampler2D texture;\n"
 	""
@@ -42,5 +55,62 @@ static const char *fragmentSource =
 	"	gl_FragColor = texture2D(texture, TexCoord);\n"
 	"}";
 
+// GL 3.3 core, a unit quad per instance placed by (x, y, size, orientation).
+static const char *const instancedVertexSource =
+	"#version 330 core\n"
+	"uniform mat3 proj;\n"
+	"out vec2 TexCoord;\n"
+	""
+	"in vec2 corner;\n"
+	"in vec4 quad;\n"
+	""
+	ORIENT_SOURCE
+	"void main() {\n"
+	"	gl_Position = vec4(proj * vec3(quad.xy + corner * quad.z, 1), 1);\n"
+	"	TexCoord = orient(corner, quad.w);\n"
+	"}";
+
+static const char *const instancedFragmentSource =
+	"#version 330 core\n"
+	"in vec2 TexCoord;\n"
+	"out vec4 FragColor;\n"
+	"uniform sampler2D sprite;\n"
+	""
+	"void main() {\n"
+	"	FragColor = texture(sprite, TexCoord);\n"
+	"}";
+
+// GL 3.3 core, a unit quad per map cell, or a few pixels off it, with the
+// sprite as array layer.
+static const char *const tileVertexSource =
+	"#version 330 core\n"
+	"uniform mat3 proj;\n"
+	"out vec2 TexCoord;\n"
+	"flat out float Layer;\n"
+	""
+	"in vec2 corner;\n"
+	"in ivec2 cell;\n"
+	"in uint sprite;\n"
+	"in uint placement;\n"
+	""
+	ORIENT_SOURCE
+	"void main() {\n"
+	"	vec2 offset = vec2((placement >> 4u) & 31u, (placement >> 9u) & 31u);\n"
+	"	gl_Position = vec4(proj * vec3((vec2(cell) + corner) * 32.0 + offset, 1), 1);\n"
+	"	TexCoord = orient(corner, float(placement & 15u));\n"
+	"	Layer = float(sprite);\n"
+	"}";
+
+static const char *const tileFragmentSource =
+	"#version 330 core\n"
+	"in vec2 TexCoord;\n"
+	"flat in float Layer;\n"
+	"out vec4 FragColor;\n"
+	"uniform sampler2DArray sprites;\n"
+	""
+	"void main() {\n"
+	"	FragColor = texture(sprites, vec3(TexCoord, Layer));\n"
+	"}";
+
 #endif
 
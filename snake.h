@@ -39,28 +39,51 @@ typedef enum Direction {
 	DIRECTION_INVALID
 } Direction_t;
 
+// The sprite a snake heading @dir is drawn with.
+inline SpriteId snakeSprite(Direction_t dir)
+{
+	switch (dir) {
+	case DIRECTION_EAST:
+		return SPRITE_SNAKE_FIRST;
+	case DIRECTION_NORTHEAST:
+		return SPRITE_SNAKE_FIRST + 1;
+	case DIRECTION_NORTH:
+		return SPRITE_SNAKE_FIRST + 2;
+	case DIRECTION_NORTHWEST:
+		return SPRITE_SNAKE_FIRST + 3;
+	case DIRECTION_WEST:
+		return SPRITE_SNAKE_FIRST + 4;
+	case DIRECTION_SOUTHWEST:
+		return SPRITE_SNAKE_FIRST + 5;
+	case DIRECTION_SOUTH:
+		return SPRITE_SNAKE_FIRST + 6;
+	case DIRECTION_SOUTHEAST:
+		return SPRITE_SNAKE_FIRST + 7;
+	default:
+		return SPRITE_NONE;
+	}
+}
+
 class Snake
 {
 public:
 	Snake()
-		: m_tile(nullptr), m_dir(DIRECTION_INVALID),
+		: m_sprite(SPRITE_NONE), m_dir(DIRECTION_INVALID),
 		  m_health(50)
 	{ }
-	~Snake() { m_tile = nullptr; }
 
-	void setPos(const Point& pos) { m_tile->setPos(pos); }
-	Point pos() const { return m_tile->pos(); }
+	// Puts the snake down, moveTo() slides it there instead.
+	void setPos(const Point& pos) { m_pos = m_lastPos = pos; }
+	void moveTo(const Point& pos) { m_pos = pos; }
+	Point pos() const { return m_pos; }
+	// Where it was when its current tick started, it is drawn on the way
+	// from there to pos().
+	Point lastPos() const { return m_lastPos; }
+	void beginTick() { m_lastPos = m_pos; }
 
-	TilePtr tile() const { return m_tile; }
-	void setTile(const TilePtr& tile) { m_tile = tile; }
-
-	void setTexture(const TexturePtr& texture)
-	{
-		// Make sure we are not removing the ground texture.
-		if (m_tile->getTextures().size() > 1)
-			m_tile->popTexture();
-		m_tile->addTexture(texture);
-	}
+	// What the snake looks like, the Game puts it on the map's actor layer.
+	SpriteId sprite() const { return m_sprite; }
+	void setSprite(SpriteId sprite) { m_sprite = sprite; }
 
 	Direction_t direction() const { return m_dir; }
 	void setDirection(Direction_t newDir) { m_dir = newDir; }
@@ -83,8 +106,8 @@ public:
 		 *             |
 		 *            -y
 		 */
-		int x = m_tile->pos().x();
-		int y = m_tile->pos().y();
+		int x = m_pos.x();
+		int y = m_pos.y();
 
 		switch (m_dir) {
 		case DIRECTION_NORTH:
@@ -124,7 +147,9 @@ public:
 	}
 
 private:
-	TilePtr m_tile;
+	Point m_pos;
+	Point m_lastPos;
+	SpriteId m_sprite;
 	Direction_t m_dir;
 	int m_health;
 };
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "softrenderer.h"
+#include "threadpool.h"
+
+#include <SOIL/SOIL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+// Fewer rows than this per band aren't worth a thread.
+static const int minRowsPerThread = 32;
+
+// cos() of the 45 degree orientation steps, exact where it can be.
+static const float orientCos[8] = { 1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f, 0.0f, 0.70710678f };
+
+/*
+ * dst = src + dst * (255 - src.a) / 255 for every channel, the division
+ * rounded the way GL implementations do it: (t + (t >> 8)) >> 8 with
+ * t = x * y + 128 is round(x * y / 255) for all 8 bit x and y.
+ */
+static void blendRowScalar(uint32_t *dst, const uint32_t *src, int n)
+{
+	for (int i = 0; i < n; ++i) {
+		const uint32_t s = src[i];
+		const uint32_t d = dst[i];
+		const uint32_t inverseAlpha = 255 - (s >> 24);
+
+		uint32_t out = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			uint32_t t = ((d >> shift) & 0xff) * inverseAlpha + 128;
+			t = ((t + (t >> 8)) >> 8) + ((s >> shift) & 0xff);
+			out |= std::min(t, 255u) << shift;
+		}
+		dst[i] = out;
+	}
+}
+
+#ifdef __SSE2__
+static void blendRowSse2(uint32_t *dst, const uint32_t *src, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+
+		// 255 - alpha in every byte of each pixel.
+		__m128i a = _mm_srli_epi32(s, 24);
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+		const __m128i inverseAlpha = _mm_xor_si128(a, _mm_set1_epi32(-1));
+
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inverseAlpha, zero));
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inverseAlpha, zero));
+		lo = _mm_add_epi16(lo, round);
+		hi = _mm_add_epi16(hi, round);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+	}
+	blendRowScalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void blendRowAvx2(uint32_t *dst, const uint32_t *src, int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi16(128);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+
+		__m256i a = _mm256_srli_epi32(s, 24);
+		a = _mm256_or_si256(a, _mm256_slli_epi32(a, 8));
+		a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+		const __m256i inverseAlpha = _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+
+		// Unpacking and packing both stay within 128 bit lanes, so the
+		// pixels come back in order.
+		__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(inverseAlpha, zero));
+		__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(inverseAlpha, zero));
+		lo = _mm256_add_epi16(lo, round);
+		hi = _mm256_add_epi16(hi, round);
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+	}
+	blendRowSse2(dst + i, src + i, n - i);
+}
+#endif
+
+typedef void (*BlendRowFunc)(uint32_t *dst, const uint32_t *src, int n);
+
+static BlendRowFunc pickBlendRow()
+{
+#ifdef __SSE2__
+	// Runs before main(), the CPU info isn't set up yet.
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return blendRowAvx2;
+	return blendRowSse2;
+#else
+	return blendRowScalar;
+#endif
+}
+
+static const BlendRowFunc blendRow = pickBlendRow();
+
+SoftRenderer::SoftRenderer()
+	: m_width(0),
+	  m_height(0),
+	  m_cameraX(0.0f),
+	  m_cameraY(0.0f),
+	  m_zoom(1.0f)
+{
+}
+
+bool SoftRenderer::loadSprites()
+{
+	for (SpriteId sprite = SPRITE_GRASS; sprite < SPRITE_COUNT; ++sprite) {
+		if (!spriteFiles[sprite])
+			continue;
+
+		int width, height;
+		unsigned char *data = SOIL_load_image(spriteFiles[sprite], &width, &height, 0, SOIL_LOAD_RGBA);
+		if (!data) {
+			std::cerr << "Failed to load " << spriteFiles[sprite] << std::endl;
+			return false;
+		}
+
+		setSprite(sprite, data, width, height);
+		SOIL_free_image_data(data);
+	}
+	return true;
+}
+
+void SoftRenderer::setSprite(SpriteId sprite, const uint8_t *rgba, int width, int height)
+{
+	Image& image = m_sprites[sprite];
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((size_t)width * height);
+	memcpy(image.rgba.data(), rgba, image.rgba.size() * 4);
+}
+
+void SoftRenderer::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_pixels.assign((size_t)width * height, 0);
+}
+
+void SoftRenderer::setView(float cameraX, float cameraY, float zoom)
+{
+	m_cameraX = cameraX;
+	m_cameraY = cameraY;
+	m_zoom = zoom;
+}
+
+void SoftRenderer::submit(unsigned layer, SpriteId sprite, float x, float y, float size)
+{
+	if (sprite < SPRITE_COUNT && loaded(sprite))
+		m_commands.push_back(Command { layer, spriteImage(sprite), spriteOrientation(sprite), x, y, size });
+}
+
+void SoftRenderer::flush()
+{
+	// Layers in order, submission order within one like GL would.
+	std::stable_sort(m_commands.begin(), m_commands.end(),
+		[] (const Command& a, const Command& b) { return a.layer < b.layer; });
+
+	const int bands = std::max(1, std::min((int)g_threadPool.width(), m_height / minRowsPerThread));
+	if (bands > 1) {
+		const int rows = (m_height + bands - 1) / bands;
+		g_threadPool.run(bands,
+			[this, rows] (size_t i) { drawRows(std::min((int)i * rows, m_height), std::min(((int)i + 1) * rows, m_height)); });
+	} else
+		drawRows(0, m_height);
+
+	m_commands.clear();
+}
+
+void SoftRenderer::drawRows(int y0, int y1)
+{
+	std::fill(m_pixels.begin() + (size_t)y0 * m_width, m_pixels.begin() + (size_t)y1 * m_width, 0xff000000u);
+
+	std::vector<uint32_t> scaled;
+	std::vector<int> columns;
+	for (const Command& command : m_commands) {
+		const Image& image = m_sprites[command.image];
+		const float size = command.size * m_zoom;
+		const float left = (command.x - m_cameraX) * m_zoom + m_width / 2.0f;
+		const float bottom = (command.y - m_cameraY) * m_zoom + m_height / 2.0f;
+
+		// GL covers the pixels whose centers are inside the quad.
+		const int px0 = std::max((int)std::ceil(left - 0.5f), 0);
+		const int px1 = std::min((int)std::ceil(left + size - 0.5f), m_width);
+		const int py0 = std::max((int)std::ceil(bottom - 0.5f), y0);
+		const int py1 = std::min((int)std::ceil(bottom + size - 0.5f), y1);
+		if (px0 >= px1 || py0 >= py1)
+			continue;
+
+		if (command.orientation) {
+			// The inverse of the vertex shader's orient(), per pixel.
+			const int steps = command.orientation % 8;
+			const float c = orientCos[steps];
+			const float s = -orientCos[(steps + 6) % 8];
+			const float flip = command.orientation >= 8 ? -1.0f : 1.0f;
+			scaled.resize(px1 - px0);
+			for (int py = py0; py < py1; ++py) {
+				const float dy = (py + 0.5f - bottom) / size - 0.5f;
+				for (int px = px0; px < px1; ++px) {
+					const float dx = (px + 0.5f - left) / size - 0.5f;
+					const float u = c * dx - s * dy + 0.5f;
+					const float v = flip * (s * dx + c * dy) + 0.5f;
+					const int column = std::min(std::max((int)std::floor(u * image.width), 0), image.width - 1);
+					const int row = std::min(std::max((int)std::floor(v * image.height), 0), image.height - 1);
+					scaled[px - px0] = image.rgba[(size_t)row * image.width + column];
+				}
+				blendRow(&m_pixels[(size_t)py * m_width + px0], scaled.data(), px1 - px0);
+			}
+			continue;
+		}
+
+		// Whole pixels one to one, the rows can be blended straight away.
+		const bool direct = size == image.width && size == image.height && left == std::floor(left);
+		if (!direct) {
+			columns.resize(px1 - px0);
+			for (int px = px0; px < px1; ++px)
+				columns[px - px0] = std::min(std::max((int)((px + 0.5f - left) * image.width / size), 0), image.width - 1);
+			scaled.resize(px1 - px0);
+		}
+
+		for (int py = py0; py < py1; ++py) {
+			// Texture row 0 is at the bottom of the quad.
+			const int row = std::min(std::max((int)((py + 0.5f - bottom) * image.height / size), 0), image.height - 1);
+			const uint32_t *src = &image.rgba[(size_t)row * image.width];
+			uint32_t *dst = &m_pixels[(size_t)py * m_width + px0];
+
+			if (direct)
+				blendRow(dst, src + (px0 - (int)left), px1 - px0);
+			else {
+				for (size_t i = 0; i < columns.size(); ++i)
+					scaled[i] = src[columns[i]];
+				blendRow(dst, scaled.data(), px1 - px0);
+			}
+		}
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SOFTRENDERER_H
+#define SOFTRENDERER_H
+
+#include "sprites.h"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Draws sprites into a framebuffer in memory, for machines without GL and
+ * as a reference to check the GL output against.  Blending is the same as
+ * GL_ONE, GL_ONE_MINUS_SRC_ALPHA on an 8 bit framebuffer, rounding
+ * included, and sampling is nearest, so at zoom 1 with the view on whole
+ * pixels the result is the same as GL's down to the bit.
+ */
+class SoftRenderer
+{
+public:
+	SoftRenderer();
+
+	bool loadSprites();
+	void setSprite(SpriteId sprite, const uint8_t *rgba, int width, int height);
+	bool loaded(SpriteId sprite) const { return !m_sprites[spriteImage(sprite)].rgba.empty(); }
+
+	void resize(int width, int height);
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	// World pixel (@cameraX, @cameraY) ends up in the middle, like the GL
+	// projection matrix does.
+	void setView(float cameraX, float cameraY, float zoom);
+
+	// Same as RenderQueue, only drawn in flush().
+	void submit(unsigned layer, SpriteId sprite, float x, float y, float size = 32);
+	// Clears to opaque black and draws everything submitted, rows are
+	// spread over all cores.
+	void flush();
+
+	// RGBA, bottom row first like glReadPixels().
+	const uint8_t *pixels() const { return reinterpret_cast<const uint8_t *>(m_pixels.data()); }
+
+private:
+	struct Image {
+		int width, height;
+		std::vector<uint32_t> rgba;
+	};
+	struct Command {
+		unsigned layer;
+		SpriteId image;
+		uint8_t orientation;
+		float x, y, size;
+	};
+
+	void drawRows(int y0, int y1);
+
+	std::array<Image, SPRITE_COUNT> m_sprites;
+	std::vector<Command> m_commands;
+	std::vector<uint32_t> m_pixels;
+	int m_width;
+	int m_height;
+	float m_cameraX;
+	float m_cameraY;
+	float m_zoom;
+};
+
+#endif
+
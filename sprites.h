@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include <cstdint>
+
+/*
+ * Tiles refer to what is drawn on them by these small handles,
+ * the Game maps them to the actual textures.
+ */
+typedef uint16_t SpriteId;
+
+enum Sprite {
+	SPRITE_NONE,
+
+	SPRITE_GRASS,
+
+	// One image turned eight ways, in 45 degree steps counterclockwise
+	// from east.
+	SPRITE_SNAKE_FIRST,
+	SPRITE_SNAKE_LAST = SPRITE_SNAKE_FIRST + 7,
+
+	SPRITE_APPLE_FIRST,
+	SPRITE_APPLE_LAST = SPRITE_APPLE_FIRST + 7,
+	SPRITE_STRAWBERRY_FIRST,
+	SPRITE_STRAWBERRY_LAST = SPRITE_STRAWBERRY_FIRST + 7,
+
+	SPRITE_COUNT
+};
+
+static const char *const spriteFiles[SPRITE_COUNT] = {
+	nullptr,
+	"textures/grass.png",
+	"textures/snake.png",
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	"textures/food/apple1.png",
+	"textures/food/apple2.png",
+	"textures/food/apple3.png",
+	"textures/food/apple4.png",
+	"textures/food/apple5.png",
+	"textures/food/apple6.png",
+	"textures/food/apple7.png",
+	"textures/food/apple8.png",
+	"textures/food/strawberry1.png",
+	"textures/food/strawberry2.png",
+	"textures/food/strawberry3.png",
+	"textures/food/strawberry4.png",
+	"textures/food/strawberry5.png",
+	"textures/food/strawberry6.png",
+	"textures/food/strawberry7.png",
+	"textures/food/strawberry8.png",
+};
+
+/*
+ * Sprites without a file of their own are drawn with the image of another,
+ * turned.  The orientation is the number of 45 degree steps the image is
+ * rotated counterclockwise, plus 8 when it is also mirrored across the
+ * direction it faces so the snake keeps its belly down going west.
+ */
+inline SpriteId spriteImage(SpriteId sprite)
+{
+	if (sprite >= SPRITE_SNAKE_FIRST && sprite <= SPRITE_SNAKE_LAST)
+		return SPRITE_SNAKE_FIRST;
+	return sprite;
+}
+
+inline uint8_t spriteOrientation(SpriteId sprite)
+{
+	if (sprite < SPRITE_SNAKE_FIRST || sprite > SPRITE_SNAKE_LAST)
+		return 0;
+
+	const uint8_t steps = sprite - SPRITE_SNAKE_FIRST;
+	return steps >= 2 && steps <= 5 ? steps + 8 : steps;
+}
+
+#endif
+
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "streambuffer.h"
+
+#include <iostream>
+#include <algorithm>
+
+StreamBuffer::StreamBuffer()
+	: m_target(GL_ARRAY_BUFFER),
+	  m_id(0),
+	  m_persistent(false),
+	  m_mapped(nullptr),
+	  m_staged(false),
+	  m_frameSize(0),
+	  m_used(0),
+	  m_region(0),
+	  m_stalls(0)
+{
+	for (GLsync& fence : m_fences)
+		fence = nullptr;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	release();
+}
+
+bool StreamBuffer::create(GLenum target, size_t frameSize)
+{
+	m_target = target;
+	m_persistent = GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+	frameSize = std::max(footprint(frameSize), size_t(ALIGNMENT));
+	if (allocateStorage(frameSize))
+		return true;
+
+	// Orphaning then.
+	m_persistent = false;
+	return allocateStorage(frameSize);
+}
+
+bool StreamBuffer::allocateStorage(size_t frameSize)
+{
+	release();
+	glGenBuffers(1, &m_id);
+	glBindBuffer(m_target, m_id);
+	m_frameSize = frameSize;
+	m_region = 0;
+	if (!m_persistent)
+		return true;	// Storage comes with every begin().
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glBufferStorage(m_target, m_frameSize * REGIONS, nullptr, flags);
+	m_mapped = static_cast<unsigned char *>(glMapBufferRange(m_target, 0, m_frameSize * REGIONS, flags));
+	if (!m_mapped) {
+		std::cerr << "Failed to map a stream buffer of " << m_frameSize * REGIONS << " bytes." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void StreamBuffer::release()
+{
+	for (GLsync& fence : m_fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if (m_id) {
+		// Deleting unmaps, and whatever the GPU still reads stays alive until it's done.
+		glDeleteBuffers(1, &m_id);
+		m_id = 0;
+		m_mapped = nullptr;
+	}
+}
+
+void StreamBuffer::begin(size_t size)
+{
+	size = footprint(size);
+	m_used = 0;
+
+	if (m_persistent && size > m_frameSize) {
+		size_t frameSize = m_frameSize;
+		while (frameSize < size)
+			frameSize *= 2;
+		if (!allocateStorage(frameSize)) {
+			m_persistent = false;
+			allocateStorage(frameSize);
+		}
+	} else if (m_persistent) {
+		glBindBuffer(m_target, m_id);
+		m_region = (m_region + 1) % REGIONS;
+	}
+
+	if (!m_persistent) {
+		// Orphan the old storage, the GPU keeps reading it while we write.
+		glBindBuffer(m_target, m_id);
+		glBufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+		m_frameSize = size;
+		m_mapped = size ? static_cast<unsigned char *>(glMapBuffer(m_target, GL_WRITE_ONLY)) : nullptr;
+		m_staged = size && !m_mapped;
+		if (m_staged) {
+			m_staging.resize(size);
+			m_mapped = &m_staging[0];
+		}
+		return;
+	}
+
+	GLsync& fence = m_fences[m_region];
+	if (fence) {
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			++m_stalls;
+			do
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			while (status == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+void *StreamBuffer::allocate(size_t size, size_t& offset)
+{
+	offset = (m_persistent ? m_region * m_frameSize : 0) + m_used;
+	m_used += footprint(size);
+	return m_mapped + offset;
+}
+
+void StreamBuffer::end()
+{
+	if (!m_persistent && m_mapped) {
+		glBindBuffer(m_target, m_id);
+		if (m_staged)
+			glBufferSubData(m_target, 0, m_used, m_mapped);
+		else
+			glUnmapBuffer(m_target);
+		m_mapped = nullptr;
+		m_staged = false;
+	}
+}
+
+void StreamBuffer::fence()
+{
+	if (m_persistent)
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Vertex data written anew every frame.  With ARB_buffer_storage the
+ * buffer is mapped once for good and split in three, each frame writes
+ * the next third after waiting on the fence of the frame that used it
+ * last, so the CPU runs up to two frames ahead without ever stalling on
+ * the GPU.  Without it the buffer is orphaned and mapped every frame,
+ * which the driver can do without waiting either, only with more work.
+ * Where even that mapping fails the frame is written to memory and
+ * copied in with glBufferSubData().
+ *
+ * A frame goes begin(), allocate() as often as needed, end() and once
+ * the draws reading from it are issued, fence().
+ */
+class StreamBuffer
+{
+public:
+	StreamBuffer();
+	~StreamBuffer();
+
+	bool create(GLenum target, size_t frameSize);
+	GLuint id() const { return m_id; }
+	bool persistent() const { return m_persistent; }
+
+	// At most @size bytes will be allocated until end(), add up footprint()
+	// of each allocation.  The buffer grows if it has to, and is bound.
+	void begin(size_t size);
+	// Where to write @size bytes, @offset is the same place in the buffer.
+	void *allocate(size_t size, size_t& offset);
+	void end();
+	void fence();
+
+	static size_t footprint(size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+	// Frames whose third was still being read by the GPU.
+	size_t stalls() const { return m_stalls; }
+
+private:
+	enum { REGIONS = 3 };
+	// Vertex attributes want their offsets aligned, 16 covers all of them.
+	enum { ALIGNMENT = 16 };
+
+	bool allocateStorage(size_t frameSize);
+	void release();
+
+	GLenum m_target;
+	GLuint m_id;
+	bool m_persistent;
+	unsigned char *m_mapped;
+	// Where the frame goes when the buffer couldn't be mapped.
+	std::vector<unsigned char> m_staging;
+	bool m_staged;
+	size_t m_frameSize;
+	size_t m_used;
+	unsigned m_region;
+	GLsync m_fences[REGIONS];
+	size_t m_stalls;
+};
+
+#endif
+
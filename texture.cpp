@@ -20,43 +20,69 @@
  * THE SOFTWARE.
  */
 #include "texture.h"
+#include "glstate.h"
 
-#include <string>
-#include <SOIL/SOIL.h>
+#include <cstring>
 
 Texture::Texture()
+	: m_loaded(false),
+	  m_averageColor(0)
 {
 	glGenTextures(1, &m_id);
 }
 
+Texture::Texture(GLuint id)
+	: m_id(id),
+	  m_loaded(false),
+	  m_averageColor(0)
+{
+}
+
 Texture::~Texture()
 {
-	glDeleteTextures(1, &m_id);
+	if (m_id) {
+		glDeleteTextures(1, &m_id);
+		g_glState.textureDeleted(m_id);
+	}
 }
 
-bool Texture::loadTexture(const std::string& fileName)
+void Texture::upload(const unsigned char *data, int width, int height)
 {
-	int width;
-	int height;
-	unsigned char *data = SOIL_load_image(fileName.c_str(), &width, &height, 0, SOIL_LOAD_RGBA);
-	if (!data)
-		return false;
-
-	glBindTexture(GL_TEXTURE_2D, m_id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	// Trilinear, so that zooming out doesn't alias.
+	const bool generateMipmap = GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+
+	g_glState.bindTexture(m_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+	if (!generateMipmap)
+		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
 			width, height, 0,
 			GL_RGBA, GL_UNSIGNED_BYTE, data);
+	if (generateMipmap)
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	setLoaded(data, width, height);
+}
+
+void Texture::setLoaded(const unsigned char *data, int width, int height)
+{
+	uint64_t sum[4] = { 0, 0, 0, 0 };
+	const size_t pixels = (size_t)width * height;
+	for (size_t i = 0; i < pixels * 4; ++i)
+		sum[i % 4] += data[i];
 
-	SOIL_free_image_data(data);
-	return true;
+	uint8_t average[4];
+	for (int c = 0; c < 4; ++c)
+		average[c] = pixels ? sum[c] / pixels : 0;
+	memcpy(&m_averageColor, average, sizeof(average));
+	m_loaded = true;
 }
 
 void Texture::bind()
 {
-	glBindTexture(GL_TEXTURE_2D, m_id);
+	g_glState.bindTexture(m_id);
 }
 
@@ -23,20 +23,32 @@
 #define TEXTURE_H
 
 #include <memory>
+#include <cstdint>
 
 /* The smallest class, yet the most used.  */
 class Texture
 {
 public:
 	Texture();
-	~Texture();
+	virtual ~Texture();
 
-	bool loadTexture(const std::string& fileName);
+	virtual void upload(const unsigned char *data, int width, int height);
 	void bind();
 	GLuint id() const { return m_id; }
+	bool loaded() const { return m_loaded; }
+	// Mean of all pixels as RGBA bytes in memory order, for drawing from far away.
+	uint32_t averageColor() const { return m_averageColor; }
+
+protected:
+	// For renderers that keep the pixels elsewhere, @id is 0 then.
+	explicit Texture(GLuint id);
+	// The part of upload() that doesn't touch GL.
+	void setLoaded(const unsigned char *data, int width, int height);
 
 private:
 	GLuint m_id;
+	bool m_loaded;
+	uint32_t m_averageColor;
 };
 typedef std::shared_ptr<Texture> TexturePtr;
 
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "texturecache.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <SOIL/SOIL.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char cacheMagic[4] = { 'S', 'N', 'K', 'C' };
+static const uint32_t cacheVersion = 1;
+
+struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct CacheEntry {
+	char source[96];
+	int64_t mtime;
+	int64_t size;
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+};
+
+static bool sourceStat(const std::string& source, int64_t& mtime, int64_t& size)
+{
+	struct stat st;
+	if (stat(source.c_str(), &st) != 0)
+		return false;
+
+	mtime = st.st_mtime;
+	size = st.st_size;
+	return true;
+}
+
+static void listImages(const std::string& directory, std::vector<std::string>& files)
+{
+	DIR *dir = opendir(directory.c_str());
+	if (!dir)
+		return;
+
+	while (struct dirent *ent = readdir(dir)) {
+		std::string name = ent->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		std::string path = directory + "/" + name;
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+			listImages(path, files);
+		else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+			files.push_back(path);
+	}
+	closedir(dir);
+}
+
+TextureCache::TextureCache()
+	: m_mapping(nullptr),
+	  m_mappingSize(0),
+	  m_dirty(false)
+{
+}
+
+TextureCache::~TextureCache()
+{
+	close();
+}
+
+bool TextureCache::open(const std::string& fileName)
+{
+	close();
+	m_fileName = fileName;
+
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	const unsigned char *base = static_cast<const unsigned char *>(mapping);
+	const CacheHeader *header = reinterpret_cast<const CacheHeader *>(base);
+	const size_t size = st.st_size;
+	if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0
+	    || header->version != cacheVersion
+	    || sizeof(CacheHeader) + (uint64_t)header->count * sizeof(CacheEntry) > size) {
+		std::cerr << "Ignoring invalid texture cache: " << fileName << std::endl;
+		munmap(mapping, size);
+		return false;
+	}
+
+	m_mapping = mapping;
+	m_mappingSize = size;
+
+	const CacheEntry *entries = reinterpret_cast<const CacheEntry *>(header + 1);
+	for (uint32_t i = 0; i < header->count; ++i) {
+		const CacheEntry& entry = entries[i];
+		if (entry.offset + (uint64_t)entry.width * entry.height * 4 > size)
+			continue;
+
+		Image image;
+		image.source.assign(entry.source, strnlen(entry.source, sizeof(entry.source)));
+		image.mtime = entry.mtime;
+		image.size = entry.size;
+		image.width = entry.width;
+		image.height = entry.height;
+		image.data = base + entry.offset;
+		image.owned = false;
+		m_images.push_back(image);
+	}
+
+	return true;
+}
+
+void TextureCache::close()
+{
+	for (const Image& image : m_images)
+		if (image.owned)
+			SOIL_free_image_data(const_cast<unsigned char *>(image.data));
+	m_images.clear();
+
+	if (m_mapping) {
+		munmap(m_mapping, m_mappingSize);
+		m_mapping = nullptr;
+		m_mappingSize = 0;
+	}
+	m_dirty = false;
+}
+
+const unsigned char *TextureCache::lookup(const std::string& source, int& width, int& height) const
+{
+	auto it = std::find_if(m_images.begin(), m_images.end(),
+				[&] (const Image& image) { return image.source == source; } );
+	if (it == m_images.end())
+		return nullptr;
+
+	int64_t mtime, size;
+	if (!sourceStat(source, mtime, size) || mtime != it->mtime || size != it->size)
+		return nullptr;
+
+	width = it->width;
+	height = it->height;
+	return it->data;
+}
+
+void TextureCache::store(const std::string& source, unsigned char *data, int width, int height)
+{
+	Image image;
+	image.source = source;
+	image.width = width;
+	image.height = height;
+	image.data = data;
+	image.owned = true;
+	if (!sourceStat(source, image.mtime, image.size)) {
+		SOIL_free_image_data(data);
+		return;
+	}
+
+	auto it = std::find_if(m_images.begin(), m_images.end(),
+				[&] (const Image& other) { return other.source == source; } );
+	if (it != m_images.end()) {
+		if (it->owned)
+			SOIL_free_image_data(const_cast<unsigned char *>(it->data));
+		*it = image;
+	} else
+		m_images.push_back(image);
+	m_dirty = true;
+}
+
+bool TextureCache::flush()
+{
+	if (!m_dirty || m_fileName.empty())
+		return true;
+
+	if (!write(m_fileName, m_images))
+		return false;
+
+	// The new file replaced the mapped one, re-open it so that we
+	// stop holding on to the decoded copies.
+	std::string fileName = m_fileName;
+	return open(fileName);
+}
+
+bool TextureCache::build(const std::string& fileName, const std::string& directory)
+{
+	std::vector<std::string> files;
+	listImages(directory, files);
+	std::sort(files.begin(), files.end());
+
+	std::vector<Image> images;
+	for (const std::string& source : files) {
+		Image image;
+		image.source = source;
+		image.owned = true;
+		image.data = SOIL_load_image(source.c_str(), &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+		if (!image.data || !sourceStat(source, image.mtime, image.size)) {
+			std::cerr << "Failed to load texture from: " << source << std::endl;
+			continue;
+		}
+		images.push_back(image);
+	}
+
+	bool ret = write(fileName, images);
+	for (const Image& image : images)
+		SOIL_free_image_data(const_cast<unsigned char *>(image.data));
+
+	if (ret)
+		std::cout << "Wrote " << images.size() << " textures to " << fileName << std::endl;
+	return ret;
+}
+
+bool TextureCache::write(const std::string& fileName, const std::vector<Image>& images)
+{
+	CacheHeader header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.count = 0;
+	header.reserved = 0;
+
+	std::vector<CacheEntry> entries;
+	uint64_t offset = sizeof(CacheHeader);
+	for (const Image& image : images)
+		if (image.source.size() < sizeof(CacheEntry::source))
+			offset += sizeof(CacheEntry);
+
+	for (const Image& image : images) {
+		if (image.source.size() >= sizeof(CacheEntry::source)) {
+			std::cerr << "Texture path too long for the cache: " << image.source << std::endl;
+			continue;
+		}
+
+		CacheEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		memcpy(entry.source, image.source.c_str(), image.source.size());
+		entry.mtime = image.mtime;
+		entry.size = image.size;
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.offset = (offset + 15) & ~uint64_t(15);
+		offset = entry.offset + (uint64_t)image.width * image.height * 4;
+		entries.push_back(entry);
+	}
+	header.count = entries.size();
+
+	// Write next to it and rename, the old file may still be mapped.
+	std::string tmpName = fileName + ".tmp";
+	std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Failed to open " << tmpName << " for writing." << std::endl;
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(CacheEntry));
+
+	size_t i = 0;
+	for (const Image& image : images) {
+		if (image.source.size() >= sizeof(CacheEntry::source))
+			continue;
+
+		const CacheEntry& entry = entries[i++];
+		static const char padding[16] = { 0 };
+		out.write(padding, entry.offset - (uint64_t)out.tellp());
+		out.write(reinterpret_cast<const char *>(image.data), (size_t)entry.width * entry.height * 4);
+	}
+
+	out.close();
+	if (!out || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+		std::cerr << "Failed to write the texture cache: " << fileName << std::endl;
+		unlink(tmpName.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * A single file holding the already decoded RGBA pixels of every texture,
+ * so that later starts only have to mmap() it and upload.
+ *
+ * Layout:
+ *	CacheHeader
+ *	CacheEntry[header.count]
+ *	pixel data, each image starting at entry.offset (16 byte aligned)
+ *
+ * An entry is only used if the source image still has the same size and
+ * modification time as when the cache was written.
+ */
+class TextureCache
+{
+public:
+	TextureCache();
+	~TextureCache();
+
+	bool open(const std::string& fileName);
+	void close();
+
+	// Pixels of @source if the cached copy is still fresh, nullptr otherwise.
+	const unsigned char *lookup(const std::string& source, int& width, int& height) const;
+	// Takes ownership of @data (as returned by SOIL_load_image()), see flush().
+	void store(const std::string& source, unsigned char *data, int width, int height);
+	// Rewrite the cache file if anything was stored since open().
+	bool flush();
+
+	// Offline step: decode every png under @directory and write the cache.
+	static bool build(const std::string& fileName, const std::string& directory);
+
+private:
+	struct Image {
+		std::string source;
+		int64_t mtime;
+		int64_t size;
+		int width;
+		int height;
+		const unsigned char *data;
+		bool owned;
+	};
+
+	static bool write(const std::string& fileName, const std::vector<Image>& images);
+
+	std::string m_fileName;
+	void *m_mapping;
+	size_t m_mappingSize;
+	std::vector<Image> m_images;
+	bool m_dirty;
+};
+
+#endif
+
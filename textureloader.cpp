@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "textureloader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <SOIL/SOIL.h>
+
+TextureLoader::TextureLoader()
+	: m_cache(nullptr),
+	  m_closed(false),
+	  m_pending(0)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	close();
+	for (std::thread& worker : m_workers)
+		worker.join();
+
+	for (Job& job : m_decoded)
+		if (job.data && !job.cached)
+			SOIL_free_image_data(job.data);
+}
+
+void TextureLoader::start(unsigned workers)
+{
+	if (!workers)
+		workers = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < workers; ++i)
+		m_workers.push_back(std::thread(std::bind(&TextureLoader::workerThread, this)));
+}
+
+void TextureLoader::queue(const TexturePtr& texture, const std::string& fileName)
+{
+	Job job { texture, fileName, nullptr, 0, 0, false };
+	if (m_cache) {
+		job.data = const_cast<unsigned char *>(m_cache->lookup(fileName, job.width, job.height));
+		job.cached = job.data != nullptr;
+	}
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	++m_pending;
+	if (job.cached)
+		m_decoded.push_back(job);	// Nothing to decode.
+	else {
+		m_jobs.push_back(job);
+		m_jobCondition.notify_one();
+	}
+}
+
+void TextureLoader::close()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_closed = true;
+	m_jobCondition.notify_all();
+}
+
+size_t TextureLoader::poll()
+{
+	std::vector<Job> decoded;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		decoded.swap(m_decoded);
+		m_pending -= decoded.size();
+	}
+
+	size_t uploaded = 0;
+	for (Job& job : decoded) {
+		if (!job.data) {
+			std::cerr << "Failed to load texture from: " << job.fileName << std::endl;
+			continue;
+		}
+
+		job.texture->upload(job.data, job.width, job.height);
+		// Cached jobs point into the cache mapping, nothing to free.
+		if (!job.cached) {
+			if (m_cache)
+				m_cache->store(job.fileName, job.data, job.width, job.height);
+			else
+				SOIL_free_image_data(job.data);
+		}
+		++uploaded;
+	}
+
+	return uploaded;
+}
+
+bool TextureLoader::wait(const TexturePtr& texture)
+{
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+	for (;;) {
+		uniqueLock.unlock();
+		poll();
+		if (texture->loaded())
+			return true;
+
+		uniqueLock.lock();
+		auto isQueued = [&] (const Job& job) { return job.texture == texture; };
+		if (m_decoded.empty()
+		    && std::none_of(m_jobs.begin(), m_jobs.end(), isQueued)
+		    && m_pending == m_jobs.size())
+			return false;	// Neither queued nor being decoded, it failed.
+
+		while (m_decoded.empty())
+			m_doneCondition.wait(uniqueLock);
+	}
+}
+
+size_t TextureLoader::pending() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_pending;
+}
+
+void TextureLoader::workerThread()
+{
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+
+	for (;;) {
+		while (m_jobs.empty() && !m_closed)
+			m_jobCondition.wait(uniqueLock);
+		if (m_jobs.empty())
+			break;
+
+		Job job = m_jobs.front();
+		m_jobs.pop_front();
+		uniqueLock.unlock();
+
+		job.data = SOIL_load_image(job.fileName.c_str(), &job.width, &job.height, 0, SOIL_LOAD_RGBA);
+
+		uniqueLock.lock();
+		m_decoded.push_back(job);
+		m_doneCondition.notify_all();
+	}
+}
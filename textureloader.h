@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include "texture.h"
+#include "texturecache.h"
+
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <string>
+
+/*
+ * Decodes images on a pool of worker threads.  The decoded pixels
+ * are handed back to whoever calls poll() (the GL thread) which
+ * does the actual upload, one texture at a time.
+ */
+class TextureLoader
+{
+public:
+	TextureLoader();
+	~TextureLoader();
+
+	void start(unsigned workers = 0);
+	// Serve images from @cache when fresh and store freshly decoded ones in it.
+	void setCache(TextureCache *cache) { m_cache = cache; }
+	void queue(const TexturePtr& texture, const std::string& fileName);
+	// No more textures will be queued, workers exit once the queue is drained.
+	void close();
+
+	// Upload whatever finished decoding so far, returns the number of uploads.
+	size_t poll();
+	// Block until @texture is uploaded (or failed to decode).
+	bool wait(const TexturePtr& texture);
+
+	size_t pending() const;
+
+protected:
+	void workerThread();
+
+private:
+	struct Job {
+		TexturePtr texture;
+		std::string fileName;
+		unsigned char *data;
+		int width;
+		int height;
+		bool cached;
+	};
+
+	TextureCache *m_cache;
+	bool m_closed;
+	size_t m_pending;
+
+	std::deque<Job> m_jobs;
+	std::vector<Job> m_decoded;
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_jobCondition;
+	std::condition_variable m_doneCondition;
+};
+
+#endif
+
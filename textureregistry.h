@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TEXTUREREGISTRY_H
+#define TEXTUREREGISTRY_H
+
+#include "sprites.h"
+#include "texture.h"
+
+#include <array>
+
+/* Maps the sprite handles stored in tiles to their GL textures.  */
+class TextureRegistry
+{
+public:
+	void set(SpriteId sprite, const TexturePtr& texture) { m_textures[sprite] = texture; }
+	const TexturePtr& get(SpriteId sprite) const { return m_textures[sprite]; }
+	const TexturePtr& operator[](SpriteId sprite) const { return m_textures[sprite]; }
+
+	bool loaded(SpriteId sprite) const
+	{
+		const TexturePtr& texture = m_textures[sprite];
+		return texture && texture->loaded();
+	}
+
+	void clear() { m_textures.fill(nullptr); }
+
+private:
+	std::array<TexturePtr, SPRITE_COUNT> m_textures;
+};
+
+#endif
+
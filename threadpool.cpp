@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "threadpool.h"
+
+#include <algorithm>
+
+ThreadPool g_threadPool;
+
+ThreadPool::ThreadPool()
+	: m_width(std::max(std::thread::hardware_concurrency(), 1u)),
+	  m_job(nullptr),
+	  m_count(0),
+	  m_next(0),
+	  m_generation(0),
+	  m_busy(0),
+	  m_stopped(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopped = true;
+		m_startCondition.notify_all();
+	}
+
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void (size_t)>& job)
+{
+	std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+	if (!runLock || m_stopped || count < 2 || m_width < 2) {
+		uniqueLock.unlock();
+		for (size_t i = 0; i < count; ++i)
+			job(i);
+		return;
+	}
+
+	if (m_threads.empty())
+		for (unsigned i = 1; i < m_width; ++i)
+			m_threads.push_back(std::thread(&ThreadPool::workerThread, this));
+
+	m_job = &job;
+	m_count = count;
+	m_next = 0;
+	m_busy = m_threads.size();
+	++m_generation;
+	m_startCondition.notify_all();
+	uniqueLock.unlock();
+
+	work();
+
+	uniqueLock.lock();
+	while (m_busy)
+		m_doneCondition.wait(uniqueLock);
+	m_job = nullptr;
+}
+
+void ThreadPool::work()
+{
+	for (size_t i = m_next++; i < m_count; i = m_next++)
+		(*m_job)(i);
+}
+
+void ThreadPool::workerThread()
+{
+	std::unique_lock<std::mutex> uniqueLock(m_mutex);
+	uint64_t generation = 0;
+
+	for (;;) {
+		while (m_generation == generation && !m_stopped)
+			m_startCondition.wait(uniqueLock);
+		if (m_stopped)
+			break;
+		generation = m_generation;
+
+		uniqueLock.unlock();
+		work();
+		uniqueLock.lock();
+
+		if (!--m_busy)
+			m_doneCondition.notify_one();
+	}
+}
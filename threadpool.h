@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+/*
+ * Threads that stay around for splitting one piece of work up, so that
+ * doing so every tick or frame doesn't start and join threads each time.
+ * They are started the first time they're needed.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	// How many parts run() can run at the same time, counting the caller.
+	unsigned width() const { return m_width; }
+	// Calls @job with 0 to @count - 1 on the pool and this thread, returns
+	// once every call has.  While another thread's run() is going this
+	// one runs all of them itself.
+	void run(size_t count, const std::function<void (size_t)>& job);
+
+protected:
+	void workerThread();
+
+private:
+	void work();
+
+	const unsigned m_width;
+	std::vector<std::thread> m_threads;
+	// Held for as long as a run() goes.
+	std::mutex m_runMutex;
+
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	const std::function<void (size_t)> *m_job;
+	size_t m_count;
+	std::atomic<size_t> m_next;
+	// Bumped for every run(), each thread takes part in each once.
+	uint64_t m_generation;
+	unsigned m_busy;
+	bool m_stopped;
+};
+
+extern ThreadPool g_threadPool;
+
+#endif
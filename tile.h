@@ -23,33 +23,15 @@
 #define TILE_H
 
 #include "point.h"
-#include "texture.h"
+#include "sprites.h"
 
-#include <vector>
+enum TileLayer {
+	LAYER_GROUND,
+	LAYER_ITEM,	// food
+	LAYER_ACTOR,	// snake
 
-class Tile
-{
-public:
-	Tile(const Point& pos);
-	~Tile();
-
-	void addTexture(const TexturePtr& texture);
-	void removeTexture(const TexturePtr& texture);
-	TexturePtr popTexture();
-
-	Point pos() const { return m_pos; }
-	Point& pos() { return m_pos; }
-	void setPos(const Point& pos) { m_pos = pos; }
-
-	void clear() { m_textures.clear(); }
-	std::vector<TexturePtr> getTextures() const { return m_textures; }
-
-private:
-	Point m_pos;
-	std::vector<TexturePtr> m_textures;
+	LAYER_COUNT
 };
 
-typedef std::shared_ptr<Tile> TilePtr;
-
 #endif
 
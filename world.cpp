@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "world.h"
+#include "threadpool.h"
+
+#include <cstdlib>
+
+// Random picks before looking through every cell for a free one.
+static const int freePosTries = 64;
+
+// Below this the pool costs more than it saves.
+static const size_t parallelThinkMin = 4096;
+
+static const int dirX[] = { 0, 0, 1, -1, -1, 1, -1, 1 };
+static const int dirY[] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+
+static uint32_t nextRandom(uint32_t& seed)
+{
+	// xorshift32, rand() is neither thread safe nor cheap.
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+SnakeId World::addSnake(const Point& pos, Direction_t dir, SnakeControl control)
+{
+	SnakeId id = m_snakes.size();
+	if (!m_freeIds.empty()) {
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	} else {
+		m_snakes.push_back(Snake());
+		m_agents.push_back(Agent());
+	}
+
+	const GridPoint cell = GridPoint::fromPixels(pos);
+	Snake& snake = m_snakes[id];
+	snake = Snake();
+	snake.setPos(pos);
+	snake.setDirection(dir);
+	snake.setSprite(snakeSprite(dir));
+
+	Agent agent = { true, control, (uint32_t)std::rand() | 1, dir, cell };
+	m_agents[id] = agent;
+
+	m_occupied[cell] = id;
+	m_map.setSprite(cell, LAYER_ACTOR, snake.sprite());
+	return id;
+}
+
+void World::removeSnake(SnakeId id)
+{
+	const GridPoint cell = GridPoint::fromPixels(m_snakes[id].pos());
+	m_occupied.erase(cell);
+	m_map.setSprite(cell, LAYER_ACTOR, SPRITE_NONE);
+	m_agents[id].active = false;
+	m_freeIds.push_back(id);
+}
+
+int World::spawn(int count)
+{
+	// Leave them some room to move.
+	const long room = (long)m_map.cols() * m_map.rows() / 4 - (long)m_snakes.size();
+	count = std::max(0L, std::min((long)count, room));
+
+	m_snakes.reserve(m_snakes.size() + count);
+	m_agents.reserve(m_agents.size() + count);
+	m_occupied.reserve(m_snakes.size() + count);
+	for (int i = 0; i < count; ++i) {
+		Point pos;
+		if (!randomFreePos(pos)) {
+			count = i;
+			break;
+		}
+		addSnake(pos, static_cast<Direction_t>(std::rand() % DIRECTION_INVALID), CONTROL_AI);
+	}
+
+	m_foodTarget += std::max(count / 4, 1);
+	placeFood();
+	return count;
+}
+
+void World::clear()
+{
+	for (const auto& pair : m_occupied)
+		m_map.setSprite(pair.first, LAYER_ACTOR, SPRITE_NONE);
+	for (const GridPoint& food : m_food)
+		m_map.setSprite(food, LAYER_ITEM, SPRITE_NONE);
+
+	m_snakes.clear();
+	m_agents.clear();
+	m_occupied.clear();
+	m_food.clear();
+	m_freeIds.clear();
+	m_foodTarget = 0;
+}
+
+SnakeId World::occupant(const GridPoint& pos) const
+{
+	auto it = m_occupied.find(pos);
+	return it != m_occupied.end() ? it->second : NO_SNAKE;
+}
+
+void World::steer(SnakeId id, Direction_t dir)
+{
+	Snake& snake = m_snakes[id];
+	snake.setDirection(dir);
+	snake.setSprite(snakeSprite(dir));
+	m_map.setSprite(snake.pos(), LAYER_ACTOR, snake.sprite());
+	m_agents[id].dir = dir;
+}
+
+bool World::moveSnake(SnakeId id, const Point& to)
+{
+	Snake& snake = m_snakes[id];
+	const GridPoint from = GridPoint::fromPixels(snake.pos());
+	const GridPoint cell = GridPoint::fromPixels(to);
+	if (cell == from)
+		return true;
+	if (occupant(cell) != NO_SNAKE)
+		return false;
+
+	m_occupied.erase(from);
+	m_occupied[cell] = id;
+	m_map.setSprite(from, LAYER_ACTOR, SPRITE_NONE);
+	m_map.setSprite(cell, LAYER_ACTOR, snake.sprite());
+	snake.moveTo(to);
+	m_agents[id].target = cell;
+	return true;
+}
+
+int World::foodValue(SpriteId food)
+{
+	if (food >= SPRITE_APPLE_FIRST && food <= SPRITE_APPLE_LAST)
+		return food - SPRITE_APPLE_FIRST + 1;
+	if (food >= SPRITE_STRAWBERRY_FIRST && food <= SPRITE_STRAWBERRY_LAST)
+		return -(food - SPRITE_STRAWBERRY_FIRST + 1);
+	return 0;
+}
+
+int World::eat(SnakeId id, const GridPoint& pos)
+{
+	const SpriteId food = m_map.sprite(pos, LAYER_ITEM);
+	if (food == SPRITE_NONE)
+		return m_snakes[id].eat(0);
+
+	m_map.setSprite(pos, LAYER_ITEM, SPRITE_NONE);
+	m_food.erase(pos);
+	return m_snakes[id].eat(foodValue(food));
+}
+
+GridPoint World::neighbour(const GridPoint& pos, int dir) const
+{
+	// Same wrapping around the edges as the player gets.
+	int x = pos.x() + dirX[dir];
+	int y = pos.y() + dirY[dir];
+	if (x < 0)		x = m_map.cols() - 1;
+	if (x >= m_map.cols())	x = 0;
+	if (y < 0)		y = m_map.rows() - 1;
+	if (y >= m_map.rows())	y = 0;
+	return GridPoint(x, y);
+}
+
+void World::think(size_t begin, size_t end)
+{
+	// Only reads the world and writes to its own agents.
+	for (size_t id = begin; id < end; ++id) {
+		Agent& agent = m_agents[id];
+		if (!agent.active || agent.control == CONTROL_LOCAL)
+			continue;
+
+		const GridPoint pos = GridPoint::fromPixels(m_snakes[id].pos());
+		agent.target = pos;
+
+		if (agent.control == CONTROL_REMOTE) {
+			agent.dir = m_snakes[id].direction();
+			if (agent.dir != DIRECTION_INVALID && occupant(neighbour(pos, agent.dir)) == NO_SNAKE)
+				agent.target = neighbour(pos, agent.dir);
+			continue;
+		}
+
+		// Food right next to it wins.
+		bool found = false;
+		for (int dir = 0; dir < DIRECTION_INVALID && !found; ++dir) {
+			const GridPoint next = neighbour(pos, dir);
+			if (m_map.sprite(next, LAYER_ITEM) != SPRITE_NONE && occupant(next) == NO_SNAKE) {
+				agent.dir = static_cast<Direction_t>(dir);
+				agent.target = next;
+				found = true;
+			}
+		}
+		if (found)
+			continue;
+
+		// Otherwise keep going with the odd turn, around whoever is in the way.
+		int dir = agent.dir;
+		if (!(nextRandom(agent.seed) & 7))
+			dir = nextRandom(agent.seed) % DIRECTION_INVALID;
+		for (int tries = 0; tries < DIRECTION_INVALID; ++tries, dir = (dir + 1) % DIRECTION_INVALID) {
+			const GridPoint next = neighbour(pos, dir);
+			if (occupant(next) == NO_SNAKE) {
+				agent.dir = static_cast<Direction_t>(dir);
+				agent.target = next;
+				break;
+			}
+		}
+	}
+}
+
+void World::step()
+{
+	const size_t count = m_snakes.size();
+	const size_t slices = count >= parallelThinkMin ? g_threadPool.width() : 1;
+	if (slices > 1) {
+		const size_t slice = (count + slices - 1) / slices;
+		g_threadPool.run(slices,
+			[this, slice, count] (size_t i) { think(std::min(i * slice, count), std::min((i + 1) * slice, count)); });
+	} else
+		think(0, count);
+
+	// A cell taken at the start of the step stays taken, two snakes
+	// going for the same free one are settled by who came first.
+	m_claims.clear();
+	for (SnakeId id = 0; id < count; ++id) {
+		Agent& agent = m_agents[id];
+		const GridPoint pos = GridPoint::fromPixels(m_snakes[id].pos());
+		if (!agent.active || agent.control == CONTROL_LOCAL || agent.target == pos)
+			continue;
+		if (occupant(agent.target) != NO_SNAKE || !m_claims.emplace(agent.target, id).second)
+			agent.target = pos;
+	}
+
+	for (SnakeId id = 0; id < count; ++id) {
+		Agent& agent = m_agents[id];
+		Snake& snake = m_snakes[id];
+		if (!agent.active || agent.control == CONTROL_LOCAL)
+			continue;
+
+		snake.beginTick();
+		if (snake.direction() != agent.dir)
+			steer(id, agent.dir);
+		if (!moveSnake(id, agent.target.toPixels()))
+			continue;
+		if (eat(id, agent.target) <= 0)
+			respawn(id);
+	}
+
+	placeFood();
+}
+
+bool World::randomFreePos(Point& pos) const
+{
+	auto free = [this] (const GridPoint& cell) {
+		return occupant(cell) == NO_SNAKE && m_map.sprite(cell, LAYER_ITEM) == SPRITE_NONE;
+	};
+
+	// @pos is only written once a free cell turns up.
+	Point pick;
+	for (int i = 0; i < freePosTries && m_map.getRandomPos(m_map.bounds(), pick); ++i) {
+		if (free(GridPoint::fromPixels(pick))) {
+			pos = pick;
+			return true;
+		}
+	}
+
+	// Nearly full, go through all of them from somewhere random.
+	const long cells = (long)m_map.cols() * m_map.rows();
+	const long start = cells ? std::rand() % cells : 0;
+	for (long i = 0; i < cells; ++i) {
+		const long index = (start + i) % cells;
+		const GridPoint cell(index % m_map.cols(), index / m_map.cols());
+		if (free(cell)) {
+			pos = cell.toPixels();
+			return true;
+		}
+	}
+	return false;
+}
+
+void World::respawn(SnakeId id)
+{
+	// Too many strawberries, start over somewhere else, or right there
+	// if there's no room.
+	const Direction_t dir = m_snakes[id].direction();
+	Point pos;
+	if (!randomFreePos(pos))
+		pos = m_snakes[id].pos();
+	m_map.setSprite(m_snakes[id].pos(), LAYER_ACTOR, SPRITE_NONE);
+	m_occupied.erase(GridPoint::fromPixels(m_snakes[id].pos()));
+
+	m_snakes[id] = Snake();
+	m_snakes[id].setPos(pos);
+	m_snakes[id].setDirection(dir);
+	m_snakes[id].setSprite(snakeSprite(dir));
+	m_agents[id].target = GridPoint::fromPixels(pos);
+	m_occupied[m_agents[id].target] = id;
+	m_map.setSprite(pos, LAYER_ACTOR, m_snakes[id].sprite());
+}
+
+void World::placeFood()
+{
+	while (m_food.size() < m_foodTarget) {
+		// No room, more goes down once some is eaten.
+		Point free;
+		if (!randomFreePos(free))
+			break;
+
+		const SpriteId first = !(std::rand() % 5) ? SPRITE_STRAWBERRY_FIRST : SPRITE_APPLE_FIRST;
+		const GridPoint pos = GridPoint::fromPixels(free);
+		m_map.setSprite(pos, LAYER_ITEM, first + std::rand() % 8);
+		m_food.insert(pos);
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013 Ahmed Samy  <f.fallen45@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "map.h"
+#include "snake.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+typedef uint32_t SnakeId;
+static constexpr SnakeId NO_SNAKE = ~0u;
+
+enum SnakeControl {
+	CONTROL_LOCAL,		// Moved by whoever added it, see moveSnake().
+	CONTROL_AI,
+	CONTROL_REMOTE		// Keeps going wherever it was last steered.
+};
+
+/*
+ * All the snakes on a map.  Which snake stands where is kept in a hash of
+ * occupied cells and the food is on the map's item layer, so every check
+ * a snake does costs the same no matter how many others there are.
+ *
+ * A step has three phases: every AI snake picks where to go looking only
+ * at the state from the previous step (so that can run on all cores),
+ * clashes are settled in snake order, then the moves are applied.
+ */
+class World
+{
+public:
+	explicit World(Map& map) : m_map(map), m_foodTarget(0) { }
+
+	// Puts a snake on the map, @pos must be free.
+	SnakeId addSnake(const Point& pos, Direction_t dir, SnakeControl control);
+	// Takes it off the map, its id is handed out again later.
+	void removeSnake(SnakeId id);
+	// Scatters up to @count AI snakes and some food for them, returns how
+	// many fit.
+	int spawn(int count);
+	void clear();
+
+	Snake& snake(SnakeId id) { return m_snakes[id]; }
+	const Snake& snake(SnakeId id) const { return m_snakes[id]; }
+	size_t snakeCount() const { return m_snakes.size(); }
+
+	SnakeId occupant(const GridPoint& pos) const;
+	// A cell with neither a snake nor food on it, false if there's none.
+	bool randomFreePos(Point& pos) const;
+	// Turns snake @id and updates how it looks.
+	void steer(SnakeId id, Direction_t dir);
+	// Moves snake @id, false if another one is in the way.  Call
+	// Snake::beginTick() first for it to slide there.
+	bool moveSnake(SnakeId id, const Point& to);
+	// Snake @id eats what lies on @pos, returns its health.
+	int eat(SnakeId id, const GridPoint& pos);
+	// Moves all AI and remote snakes one tile, and starts their tick.
+	void step();
+
+	// Health a piece of food gives, strawberries take it away.
+	static int foodValue(SpriteId food);
+
+private:
+	struct Agent {
+		bool active;
+		SnakeControl control;
+		uint32_t seed;
+		Direction_t dir;
+		GridPoint target;
+	};
+
+	void think(size_t begin, size_t end);
+	GridPoint neighbour(const GridPoint& pos, int dir) const;
+	void respawn(SnakeId id);
+	void placeFood();
+
+	Map& m_map;
+	std::vector<Snake> m_snakes;
+	std::vector<Agent> m_agents;
+	std::unordered_map<GridPoint, SnakeId> m_occupied;
+	std::unordered_map<GridPoint, SnakeId> m_claims;
+	std::unordered_set<GridPoint> m_food;
+	std::vector<SnakeId> m_freeIds;
+	size_t m_foodTarget;
+};
+
+#endif
+